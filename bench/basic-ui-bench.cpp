@@ -0,0 +1,757 @@
+// basic-ui-bench: repeatable scenarios for the renderer and text hot paths.
+//
+// Every scenario is run once to warm caches (e.g. to rasterize glyphs) and then repeated until it has run for at
+// least '--min-time-ms'.  The results are written as JSON, one object per scenario:
+//   name                  - '<area>.<scenario>[.<variant>]'.
+//   ops                   - units of work in one repetition (rects, segments, glyphs, codepoints, frames, ...).
+//   iterations            - repetitions measured.
+//   ns_per_op             - median repetition time divided by 'ops'.
+//   min_ns_per_op         - fastest repetition divided by 'ops'.
+//   elements_per_sec      - vertices (or quad instances under instanced submission) handed to the renderer's
+//                           streams per second.  Zero for scenarios which do not render.
+//   draws_per_op          - merged draws per op for scenarios which record commands.
+//   allocations_per_op    - calls to 'operator new' per op.
+//
+// By default nothing is submitted to the GPU: the renderer is initialized with 'SceneRenderer::init_without_gl' so
+// the scenarios measure the CPU side alone and run without a display.  '--gl' creates a (hidden) GL context and
+// submits for real, finishing every repetition with 'glFinish', and adds the framebuffer effect scenarios
+// ('effects.*', one 'ops' is one full screen effect).  The GL renderer is initialized once, with the vertex layout
+// picked by '--layout' (compact by default, like the app), so only that layout's 'rects.solid.*' scenarios run
+// under '--gl'; run once per layout to compare them.  Without GL both layouts run in one go.
+//
+// Usage: basic-ui-bench [--gl] [--layout standard|compact] [--filter <substring>] [--min-time-ms <ms>] [--font <path>]
+//                       [--out <path>]
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "basic-scrollbox.h"
+#include "basic-textbox.h"
+#include "basic-window.h"
+#include "config.h"
+#include "constants.h"
+#include "enum-utils.h"
+#include "examples.h"
+#include "feed.h"
+#include "glyph-cache.h"
+#include "renderer.h"
+#include "types.h"
+#include "utf-8.h"
+#include "util.h"
+#include "vec.h"
+
+namespace
+{
+    std::atomic<uint64_t> allocation_count{ 0 };
+} // namespace [anon]
+
+// Count allocations made by the scenarios.
+void* operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{ };
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+    struct Options
+    {
+        bool gl = false;
+        // The layout of the GL renderer.
+        Render::VertexLayout layout = Render::VertexLayout::Compact;
+        std::string_view filter;
+        int min_time_ms = 500;
+        std::string font_path;
+        std::string_view out_path;
+    };
+
+    struct Scenario
+    {
+        std::string name;
+        // Units of work done by one call of 'run'.
+        int ops;
+        std::function<void()> run;
+        // Called once before the scenario is measured.
+        std::function<void()> setup = [] { };
+    };
+
+    struct Result
+    {
+        std::string name;
+        int ops = 0;
+        int iterations = 0;
+        double ns_per_op = 0.;
+        double min_ns_per_op = 0.;
+        double elements_per_sec = 0.;
+        double draws_per_op = 0.;
+        double allocations_per_op = 0.;
+    };
+
+    constexpr int min_iterations = 5;
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ns(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    Result measure(const Scenario& scenario, const Options& options)
+    {
+        scenario.setup();
+        // Warm up.  Anything cached lazily (glyphs, arena capacity) is in place after this.
+        scenario.run();
+        Render::SceneRenderer::end_frame();
+
+        std::vector<double> times;
+        double total_ns = 0.;
+        uint64_t elements = 0;
+        uint64_t draws = 0;
+        const uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+        while (static_cast<int>(times.size()) < min_iterations or total_ns < options.min_time_ms * 1e6)
+        {
+            const Clock::time_point start = Clock::now();
+            scenario.run();
+            if (options.gl)
+            {
+                glFinish();
+            }
+            const double ns = elapsed_ns(start);
+            // Stats are per frame, so every repetition is a frame.
+            Render::SceneRenderer::end_frame();
+            const Render::FrameStats& stats = Render::SceneRenderer::frame_stats();
+            elements += stats.elements_streamed;
+            draws += stats.draws_submitted;
+            times.push_back(ns);
+            total_ns += ns;
+        }
+        const uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+        // The vector of times grows during the loop, which is counted as well.  That is at most a handful of
+        // allocations over the whole run.
+        std::sort(times.begin(), times.end());
+        const double iterations = static_cast<double>(times.size());
+        const double total_ops = iterations * scenario.ops;
+        return { .name = scenario.name,
+                 .ops = scenario.ops,
+                 .iterations = static_cast<int>(times.size()),
+                 .ns_per_op = times[times.size() / 2] / scenario.ops,
+                 .min_ns_per_op = times.front() / scenario.ops,
+                 .elements_per_sec = static_cast<double>(elements) / (total_ns / 1e9),
+                 .draws_per_op = static_cast<double>(draws) / total_ops,
+                 .allocations_per_op = static_cast<double>(allocations) / total_ops };
+    }
+
+    std::string results_json(const std::vector<Result>& results, const Options& options)
+    {
+        // Without GL every scenario sets up its own layout.
+        const std::string_view layout = not options.gl ? "per_scenario"
+                                       : options.layout == Render::VertexLayout::Standard ? "standard" : "compact";
+        std::string out = std::format("{{\n  \"submission\": \"{}\",\n  \"layout\": \"{}\",\n  \"scenarios\": [\n",
+                                      options.gl ? "gl" : "none",
+                                      layout);
+        for (size_t i = 0; i != results.size(); ++i)
+        {
+            const Result& r = results[i];
+            out.append(std::format("    {{ \"name\": \"{}\", \"ops\": {}, \"iterations\": {}, \"ns_per_op\": {:.3f}, "
+                                   "\"min_ns_per_op\": {:.3f}, \"elements_per_sec\": {:.0f}, \"draws_per_op\": {:.4f}, "
+                                   "\"allocations_per_op\": {:.4f} }}{}\n",
+                                   r.name,
+                                   r.ops,
+                                   r.iterations,
+                                   r.ns_per_op,
+                                   r.min_ns_per_op,
+                                   r.elements_per_sec,
+                                   r.draws_per_op,
+                                   r.allocations_per_op,
+                                   i + 1 == results.size() ? "" : ","));
+        }
+        out.append("  ]\n}\n");
+        return out;
+    }
+
+    bool parse_options(int argc, char** argv, Options* options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--gl")
+            {
+                options->gl = true;
+            }
+            else if (arg == "--layout" and has_value)
+            {
+                const std::string_view value = argv[++i];
+                if (value == "standard")
+                {
+                    options->layout = Render::VertexLayout::Standard;
+                }
+                else if (value == "compact")
+                {
+                    options->layout = Render::VertexLayout::Compact;
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Expected '--layout standard|compact', got '%s'\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (arg == "--filter" and has_value)
+            {
+                options->filter = argv[++i];
+            }
+            else if (arg == "--min-time-ms" and has_value)
+            {
+                const std::string_view value = argv[++i];
+                auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), options->min_time_ms);
+                if (ec != std::errc{} or ptr != value.data() + value.size())
+                {
+                    fprintf(stderr, "ERROR: Expected '--min-time-ms <ms>', got '%s'\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (arg == "--font" and has_value)
+            {
+                options->font_path = argv[++i];
+            }
+            else if (arg == "--out" and has_value)
+            {
+                options->out_path = argv[++i];
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unknown argument '%s'\n", argv[i]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A screen's worth of the same scene is used by every scenario.
+    constexpr ScreenDimensions bench_screen = Constants::screen;
+
+    Vec2f grid_position(int i)
+    {
+        constexpr int columns = 64;
+        return { static_cast<float>(i % columns) * 20.f, static_cast<float>(i / columns % 48) * 20.f };
+    }
+
+    // Text used by the text scenarios.
+    constexpr std::string_view ascii_line = "The quick brown fox jumps over the lazy dog. 0123456789 {}[]();";
+    constexpr std::string_view cjk_line = "\xE5\xBF\xAB\xE9\x80\x9F\xE7\x9A\x84\xE6\xA3\x95\xE8\x89\xB2\xE7\x8B\x90\xE7\x8B\xB8"
+                                          "\xE8\xB7\xB3\xE8\xBF\x87\xE4\xBA\x86\xE6\x87\x92\xE7\x8B\x97\xE3\x80\x82"
+                                          "\xE3\x81\x99\xE3\x81\xB0\xE3\x82\x84\xE3\x81\x84\xE8\x8C\xB6\xE8\x89\xB2\xE3\x81\xAE"
+                                          "\xE7\x8B\x90\xE3\x80\x82";
+
+    int codepoints_in(std::string_view text)
+    {
+        return static_cast<int>(UTF8::codepoint_count(text));
+    }
+
+    std::string repeat_lines(std::string_view line, int count)
+    {
+        std::string text;
+        text.reserve((line.size() + 1) * count);
+        for (int i = 0; i != count; ++i)
+        {
+            text.append(line);
+            text.push_back('\n');
+        }
+        return text;
+    }
+
+    // Everything the scenarios share.  Declared in 'main' so it outlives the scenarios which capture it.
+    struct BenchState
+    {
+        Render::SceneRenderer renderer;
+        Glyph::Atlas atlas;
+        bool have_atlas = false;
+
+        // Widget composition.
+        Feed::MessageFeed message_feed;
+        Examples::Intro ex_intro;
+        Examples::DragNSnap ex_dragnsnap;
+        UI::Widgets::ScrollBox scroll_box;
+        UI::Widgets::BasicTextbox text_box;
+        UI::Widgets::BasicWindow scroll_window;
+
+        // Lines.
+        std::vector<Vec2f> polyline_points;
+
+        // Decoding and line starts.
+        std::string mixed_text;
+        std::string large_buffer;
+        UI::Widgets::BasicTextbox large_text_box;
+        float large_text_box_scroll = 0.f;
+    };
+
+    void add_rect_scenarios(std::vector<Scenario>* scenarios, BenchState* state, const Options& options)
+    {
+        constexpr int rect_count = 10'000;
+        Render::SceneRenderer* renderer = &state->renderer;
+        auto draw_rects = [renderer]
+        {
+            renderer->set_shader(Render::VertShader::OneOneTransform);
+            renderer->set_shader(Render::FragShader::BasicColor);
+            for (int i = 0; i != rect_count; ++i)
+            {
+                renderer->solid_rect(grid_position(i), { 16.f, 16.f }, hex_to_vec4f(0x3080C0FF));
+            }
+            renderer->flush();
+        };
+
+        // Without GL initialization is cheap and can be repeated for each layout.  The GL renderer keeps the layout it
+        // was initialized with (see '--layout').
+        constexpr Render::VertexLayout layouts[] = { Render::VertexLayout::Standard, Render::VertexLayout::Compact };
+        for (Render::VertexLayout layout : layouts)
+        {
+            if (options.gl and layout != options.layout)
+                continue;
+            const std::string_view layout_name = layout == Render::VertexLayout::Standard ? "standard" : "compact";
+            for (Render::QuadSubmission submission : { Render::QuadSubmission::PerVertex, Render::QuadSubmission::Instanced })
+            {
+                const std::string_view submission_name = submission == Render::QuadSubmission::PerVertex ? "per_vertex" : "instanced";
+                scenarios->push_back({ .name = std::format("rects.solid.{}.{}", layout_name, submission_name),
+                                       .ops = rect_count,
+                                       .run = [=]
+                                       {
+                                           renderer->quad_submission(submission);
+                                           draw_rects();
+                                       },
+                                       .setup = [layout, &options]
+                                       {
+                                           if (not options.gl)
+                                           {
+                                               Render::SceneRenderer::init_without_gl(layout);
+                                           }
+                                       } });
+            }
+        }
+
+        // Recording adds the copy into the command list and the merge.
+        scenarios->push_back({ .name = "rects.solid.recorded",
+                               .ops = rect_count,
+                               .run = [=]
+                               {
+                                   renderer->quad_submission(Render::QuadSubmission::Instanced);
+                                   renderer->begin_command_recording();
+                                   draw_rects();
+                                   renderer->end_command_recording();
+                               },
+                               // The rest of the scenarios use the layout of the app.
+                               .setup = [&options]
+                               {
+                                   if (not options.gl)
+                                   {
+                                       Render::SceneRenderer::init_without_gl(Render::VertexLayout::Compact);
+                                   }
+                               } });
+    }
+
+    void add_line_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        constexpr int segment_count = 10'000;
+        // A sine wave across the screen, like a chart would draw.
+        state->polyline_points.resize(segment_count + 1);
+        for (int i = 0; i != segment_count + 1; ++i)
+        {
+            const float x = static_cast<float>(i) * rep(bench_screen.width) / segment_count;
+            state->polyline_points[i] = { x, rep(bench_screen.height) / 2.f + std::sin(x / 20.f) * 100.f };
+        }
+        Render::SceneRenderer* renderer = &state->renderer;
+        const std::span<const Vec2f> points = state->polyline_points;
+        scenarios->push_back({ .name = "lines.polyline",
+                               .ops = segment_count,
+                               .run = [renderer, points]
+                               {
+                                   renderer->set_shader(Render::VertShader::OneOneTransform);
+                                   renderer->set_shader(Render::FragShader::Line);
+                                   renderer->polyline(points, 2.f, hex_to_vec4f(0xCE9178FF));
+                                   renderer->flush();
+                               } });
+        scenarios->push_back({ .name = "lines.segments",
+                               .ops = segment_count,
+                               .run = [renderer, points]
+                               {
+                                   renderer->set_shader(Render::VertShader::OneOneTransform);
+                                   renderer->set_shader(Render::FragShader::Line);
+                                   for (size_t i = 0; i + 1 != points.size(); ++i)
+                                   {
+                                       renderer->line(points[i], points[i + 1], 2.f, hex_to_vec4f(0xCE9178FF));
+                                   }
+                                   renderer->flush();
+                               } });
+    }
+
+    void add_image_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        constexpr int image_count = 10'000;
+        if (not state->have_atlas)
+            return;
+        Render::SceneRenderer* renderer = &state->renderer;
+        Glyph::Atlas* atlas = &state->atlas;
+        for (Render::QuadSubmission submission : { Render::QuadSubmission::PerVertex, Render::QuadSubmission::Instanced })
+        {
+            const std::string_view submission_name = submission == Render::QuadSubmission::PerVertex ? "per_vertex" : "instanced";
+            scenarios->push_back({ .name = std::format("images.atlas.{}", submission_name),
+                                   .ops = image_count,
+                                   .run = [=]
+                                   {
+                                       renderer->quad_submission(submission);
+                                       renderer->set_shader(Render::VertShader::OneOneTransform);
+                                       renderer->set_shader(Render::FragShader::Image);
+                                       atlas->select_primary_texture(renderer);
+                                       for (int i = 0; i != image_count; ++i)
+                                       {
+                                           const float u = static_cast<float>(i % 16) / 16.f;
+                                           renderer->render_image(grid_position(i),
+                                                                  { 16.f, 16.f },
+                                                                  { u, 0.f },
+                                                                  { 1.f / 16.f, 1.f / 16.f },
+                                                                  hex_to_vec4f(0xFFFFFFFF));
+                                       }
+                                       renderer->flush();
+                                   } });
+        }
+    }
+
+    void add_text_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        if (not state->have_atlas)
+            return;
+        constexpr int line_count = 40;
+        Render::SceneRenderer* renderer = &state->renderer;
+        Glyph::Atlas* atlas = &state->atlas;
+        constexpr std::pair<std::string_view, std::string_view> texts[] = { { "ascii", ascii_line }, { "cjk", cjk_line } };
+        for (const auto& [text_name, line] : texts)
+        {
+            const int glyphs_per_line = codepoints_in(line);
+            scenarios->push_back({ .name = std::format("text.render.{}", text_name),
+                                   .ops = glyphs_per_line * line_count,
+                                   .run = [=]
+                                   {
+                                       renderer->quad_submission(Render::QuadSubmission::Instanced);
+                                       renderer->set_shader(Render::VertShader::OneOneTransform);
+                                       renderer->set_shader(Render::FragShader::Text);
+                                       auto font_ctx = atlas->render_font_context(Glyph::FontSize{ 18 });
+                                       Vec2f pos{ 10.f, 10.f };
+                                       for (int i = 0; i != line_count; ++i)
+                                       {
+                                           font_ctx.render_text(renderer, line, pos, hex_to_vec4f(0xE0E0E0FF));
+                                           pos = { 10.f, pos.y + 20.f };
+                                       }
+                                       font_ctx.flush(renderer);
+                                   } });
+            scenarios->push_back({ .name = std::format("text.measure.{}", text_name),
+                                   .ops = glyphs_per_line * line_count,
+                                   .run = [=]
+                                   {
+                                       auto font_ctx = atlas->render_font_context(Glyph::FontSize{ 18 });
+                                       float width = 0.f;
+                                       for (int i = 0; i != line_count; ++i)
+                                       {
+                                           width += font_ctx.measure_text(line).x;
+                                       }
+                                       // Keep the measurement from being optimized out.
+                                       if (width < 0.f)
+                                       {
+                                           fprintf(stderr, "%f\n", width);
+                                       }
+                                   } });
+        }
+    }
+
+    void add_utf8_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        // Roughly 1MB of mixed ASCII and CJK.
+        state->mixed_text = repeat_lines(std::format("{}{}", ascii_line, cjk_line), 8'000);
+        const std::string_view text = state->mixed_text;
+        scenarios->push_back({ .name = "utf8.codepoint_walker",
+                               .ops = codepoints_in(text),
+                               .run = [text]
+                               {
+                                   UTF8::CodepointWalker walker{ text };
+                                   UTF8::Codepoint sum = 0;
+                                   while (not walker.exhausted())
+                                   {
+                                       sum += walker.next();
+                                   }
+                                   // Keep the decode from being optimized out.
+                                   if (sum == UTF8::invalid_codepoint)
+                                   {
+                                       fprintf(stderr, "%u\n", sum);
+                                   }
+                               } });
+    }
+
+    void add_textbox_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        constexpr int line_count = 100'000;
+        state->large_buffer = repeat_lines(ascii_line, line_count);
+        UI::Widgets::BasicTextbox* text_box = &state->large_text_box;
+        const std::string_view text = state->large_buffer;
+        // 'BasicTextbox::text' copies the buffer and finds the start of every line.
+        scenarios->push_back({ .name = "textbox.populate_line_starts",
+                               .ops = line_count,
+                               .run = [text_box, text]
+                               {
+                                   text_box->text(text);
+                               } });
+
+        if (not state->have_atlas)
+            return;
+        // Scrolling within the retained lines only moves them, so a frame is a single draw of cached quads.
+        scenarios->push_back({ .name = "textbox.scroll",
+                               .ops = 1,
+                               .run = [state, text_box]
+                               {
+                                   state->large_text_box_scroll = std::fmod(state->large_text_box_scroll + 3.f, 300.f);
+                                   Render::SceneRenderer* renderer = &state->renderer;
+                                   renderer->quad_submission(Render::QuadSubmission::Instanced);
+                                   renderer->begin_command_recording();
+                                   text_box->offset({ 0.f, state->large_text_box_scroll });
+                                   text_box->render(renderer, &state->atlas, Render::RenderViewport::basic(bench_screen));
+                                   renderer->end_command_recording();
+                               },
+                               .setup = [text_box, text]
+                               {
+                                   text_box->text(text);
+                               } });
+    }
+
+    void add_frame_scenarios(std::vector<Scenario>* scenarios, BenchState* state)
+    {
+        if (not state->have_atlas)
+            return;
+        // This is the scene 'main' draws on startup, without the framebuffer effects.
+        state->text_box.text(repeat_lines(ascii_line, 40));
+        state->scroll_box.content_size(state->text_box.content_size(&state->atlas));
+        state->scroll_window.title("Scrollbar Example");
+        for (int i = 0; i != 8; ++i)
+        {
+            state->message_feed.queue_info(std::format("Message {}", i));
+        }
+        scenarios->push_back({ .name = "frame.widgets",
+                               .ops = 1,
+                               .run = [state]
+                               {
+                                   const ScreenDimensions screen = bench_screen;
+                                   Render::SceneRenderer* renderer = &state->renderer;
+                                   Glyph::Atlas* atlas = &state->atlas;
+                                   renderer->quad_submission(Render::QuadSubmission::Instanced);
+                                   renderer->begin_command_recording();
+
+                                   auto scroll_window_viewport = Render::RenderViewport::basic(screen);
+                                   scroll_window_viewport.width = Width(rep(screen.width) * 0.4);
+                                   scroll_window_viewport.height = Height(rep(screen.height) * 0.2);
+                                   {
+                                       auto vp = renderer->create_scissor_viewport(screen);
+                                       vp.apply_viewport(scroll_window_viewport);
+                                       state->scroll_window.render(renderer, atlas, scroll_window_viewport);
+
+                                       auto scroll_viewport = state->scroll_window.content_viewport(scroll_window_viewport);
+                                       vp.reset_viewport();
+                                       vp.apply_viewport(scroll_viewport);
+                                       state->scroll_box.render(renderer, scroll_viewport);
+
+                                       auto viewport_content = state->scroll_box.content_viewport(scroll_viewport);
+                                       vp.reset_viewport();
+                                       vp.apply_viewport(viewport_content);
+                                       state->text_box.render(renderer, atlas, viewport_content);
+                                   }
+
+                                   state->ex_intro.render(renderer, atlas, screen);
+
+                                   auto drag_n_snap_viewport = Render::RenderViewport::basic(screen);
+                                   drag_n_snap_viewport.height = Height{ 100 };
+                                   drag_n_snap_viewport.width = Width{ rep(screen.width) - 20 };
+                                   drag_n_snap_viewport.offset_x = Render::ViewportOffsetX{ 10 };
+                                   {
+                                       auto vp = renderer->create_scissor_viewport(screen);
+                                       vp.apply_viewport(drag_n_snap_viewport);
+                                       state->ex_dragnsnap.render(renderer, atlas, drag_n_snap_viewport);
+                                   }
+
+                                   state->message_feed.render_queue(renderer, atlas, screen);
+                                   renderer->end_command_recording();
+                               } });
+    }
+
+    // Framebuffer effects only do work on the GPU, so they are only added under '--gl'.
+    void add_effect_scenarios(std::vector<Scenario>* scenarios, BenchState* state, const Options& options)
+    {
+        if (not options.gl)
+            return;
+        constexpr std::string_view quality_names[] = { "full_resolution", "low", "medium", "high" };
+        static_assert(std::size(quality_names) == count_of<Render::Effects::BlurQuality>);
+        Render::SceneRenderer* renderer = &state->renderer;
+        for (int i = 0; i != count_of<Render::Effects::BlurQuality>; ++i)
+        {
+            const auto quality = static_cast<Render::Effects::BlurQuality>(i);
+            scenarios->push_back({ .name = std::format("effects.blur_background.{}", quality_names[i]),
+                                   .ops = 1,
+                                   .run = [=]
+                                   {
+                                       const ScreenDimensions screen = bench_screen;
+                                       renderer->set_shader(Render::VertShader::NoTransform);
+                                       Render::Effects::blur_background({ .src = Render::Framebuffer::Default, .dest = Render::Framebuffer::Default },
+                                                                        renderer,
+                                                                        screen,
+                                                                        quality);
+                                       renderer->apply_blending_mode(Render::BlendingMode::Default);
+                                   } });
+            scenarios->push_back({ .name = std::format("effects.text_glow.{}", quality_names[i]),
+                                   .ops = 1,
+                                   .run = [=]
+                                   {
+                                       const ScreenDimensions screen = bench_screen;
+                                       renderer->set_shader(Render::VertShader::NoTransform);
+                                       Render::Effects::text_glow({ .src = Render::Framebuffer::Default, .dest = Render::Framebuffer::Default },
+                                                                  renderer,
+                                                                  screen,
+                                                                  quality);
+                                       renderer->apply_blending_mode(Render::BlendingMode::Default);
+                                   } });
+        }
+    }
+
+    bool init_gl(SDL_Window** window, Render::VertexLayout layout)
+    {
+#ifndef _WIN32
+        // Without a display, SDL's offscreen driver gives us a surfaceless EGL context.
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+#endif // _WIN32
+        if (SDL_Init(SDL_INIT_VIDEO) < 0)
+        {
+            fprintf(stderr, "ERROR: Could not initialize SDL: %s\n", SDL_GetError());
+            return false;
+        }
+        *window = SDL_CreateWindow("basic-ui-bench",
+                                   SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                   rep(bench_screen.width), rep(bench_screen.height),
+                                   SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+        if (*window == nullptr)
+        {
+            fprintf(stderr, "ERROR: Could not create SDL window: %s\n", SDL_GetError());
+            return false;
+        }
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+        if (SDL_GL_CreateContext(*window) == nullptr)
+        {
+            fprintf(stderr, "ERROR: Could not create OpenGL context: %s\n", SDL_GetError());
+            return false;
+        }
+        if (glewInit() != GLEW_OK)
+        {
+            fprintf(stderr, "ERROR: Could not initialize GLEW!\n");
+            return false;
+        }
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        return Render::SceneRenderer::init(bench_screen, layout);
+    }
+} // namespace [anon]
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (not parse_options(argc, argv, &options))
+        return 1;
+
+    // Shaders and fonts are found relative to the executable, like the app does.
+    char* exe_path = SDL_GetBasePath();
+    const std::string asset_path = exe_path != nullptr ? exe_path : "";
+    SDL_free(exe_path);
+    const std::string current_dir = working_dir();
+    set_working_dir(asset_path.c_str());
+
+    SDL_Window* window = nullptr;
+    if (options.gl)
+    {
+        if (not init_gl(&window, options.layout))
+            return 1;
+    }
+    else
+    {
+        Render::SceneRenderer::init_without_gl(Render::VertexLayout::Compact);
+    }
+
+    BenchState state;
+    state.renderer.resolution(Vec2f(static_cast<float>(rep(bench_screen.width)),
+                                    static_cast<float>(rep(bench_screen.height))));
+    const std::string font_path = options.font_path.empty() ? Config::system_fonts().current_font : options.font_path;
+    state.have_atlas = state.atlas.init(font_path) and state.atlas.populate_atlas();
+    if (not state.have_atlas)
+    {
+        fprintf(stderr, "WARNING: Could not load font '%s', skipping the image, text, and frame scenarios.\n", font_path.c_str());
+    }
+    set_working_dir(current_dir.c_str());
+
+    std::vector<Scenario> scenarios;
+    add_rect_scenarios(&scenarios, &state, options);
+    add_line_scenarios(&scenarios, &state);
+    add_image_scenarios(&scenarios, &state);
+    add_text_scenarios(&scenarios, &state);
+    add_utf8_scenarios(&scenarios, &state);
+    add_textbox_scenarios(&scenarios, &state);
+    add_frame_scenarios(&scenarios, &state);
+    add_effect_scenarios(&scenarios, &state, options);
+
+    std::vector<Result> results;
+    for (const Scenario& scenario : scenarios)
+    {
+        if (scenario.name.find(options.filter) == std::string::npos)
+            continue;
+        fprintf(stderr, "%s...\n", scenario.name.c_str());
+        results.push_back(measure(scenario, options));
+    }
+
+    const std::string json = results_json(results, options);
+    if (options.out_path.empty())
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else if (save_file(options.out_path, json) != Errno::OK)
+    {
+        fprintf(stderr, "ERROR: Could not write results to '%.*s'\n", static_cast<int>(options.out_path.size()), options.out_path.data());
+        return 1;
+    }
+
+    if (window != nullptr)
+    {
+        SDL_Quit();
+    }
+    return 0;
+}
\ No newline at end of file
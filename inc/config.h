@@ -54,6 +54,8 @@ namespace Config
         bool multipass_crt;
         bool crt_mode;
         bool light_mode;
+        // A 'Render::Effects::BlurQuality'.
+        int blur_quality;
     };
 
     struct SystemColors
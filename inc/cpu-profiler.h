@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string_view>
+
+#include "util.h"
+
+// CPU scope profiling.  Every thread records into its own fixed-size ring of events, so recording takes no locks
+// and the oldest events are overwritten once a ring is full.  The rings can be written out as Chrome/Perfetto
+// trace JSON (chrome://tracing or ui.perfetto.dev).
+// The macros compile to nothing unless 'CPU_PROFILER_ENABLED' is defined (see the 'ENABLE_CPU_PROFILER' CMake
+// option).
+#ifdef CPU_PROFILER_ENABLED
+#define CPU_PROFILE_CONCAT2(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT2(a, b)
+// 'name' must be a string literal.
+#define CPU_PROFILE_SCOPE(name) CPUProfiler::Scope CPU_PROFILE_CONCAT(cpu_profile_scope_, __LINE__){ name }
+#define CPU_PROFILE_FRAME() CPUProfiler::mark_frame()
+#define CPU_PROFILE_THREAD(name) CPUProfiler::name_thread(name)
+#else
+#define CPU_PROFILE_SCOPE(name) ((void)0)
+#define CPU_PROFILE_FRAME() ((void)0)
+#define CPU_PROFILE_THREAD(name) ((void)0)
+#endif // CPU_PROFILER_ENABLED
+
+namespace CPUProfiler
+{
+    // Nanoseconds since the profiler was first used.
+    uint64_t now_ns();
+
+    // Note: The string is not copied.
+    void name_thread(const char* name);
+    void mark_frame();
+    void record_event(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+    // Writes the events of every thread.  Threads still recording may tear the events they overwrite meanwhile,
+    // so this is best called between frames.
+    Errno write_chrome_trace(std::string_view path);
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name):
+            name{ name }, begin_ns{ now_ns() } { }
+
+        ~Scope()
+        {
+            record_event(name, begin_ns, now_ns());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t begin_ns;
+    };
+} // namespace CPUProfiler
\ No newline at end of file
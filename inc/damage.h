@@ -0,0 +1,41 @@
+#pragma once
+
+#include "renderer.h"
+#include "types.h"
+
+namespace Damage
+{
+    // Parts of the screen which have to be drawn again.  Widgets report what a change in their state touches
+    // (including the area they leave behind when they move) and the main loop redraws only that into
+    // 'Framebuffer::Default', which keeps everything else from the frame before (see
+    // 'SceneRenderer::clip_to_damage').  When nothing is damaged the frame is skipped altogether.
+    // Note: What is redrawn is the bounding box of the damage rather than its exact union, so two small areas
+    // far apart (e.g. the feed and DragNSnap) redraw everything between them.  One box keeps it to a single
+    // scissor and a single pass over the scene; a list of boxes would need a pass (or a replay of the recorded
+    // commands) per box.
+    // Note: Damage may be reported from any thread, e.g. by widgets rendering on the worker pool.  Damage reported
+    // while a frame is drawn belongs to the next one, which is how animations keep themselves going.
+
+    // Takes viewport coordinates, i.e. screen space with the origin in the bottom left.  Anything off screen is
+    // ignored.
+    void add(const Render::RenderViewport& viewport);
+    // Everything, e.g. after a resize or a change of theme.
+    void add_all();
+    // Whether anything was reported since the last 'take'.
+    bool pending();
+
+    struct FrameDamage
+    {
+        // Nothing needs to be drawn.
+        bool empty = true;
+        // All of the screen needs to be drawn, so there is no need to clip.
+        bool full = false;
+        // The bounding box of everything damaged, clamped to the screen.
+        Render::ScissorRegion region{};
+    };
+
+    // Takes everything reported so far for the frame about to be drawn.
+    FrameDamage take(const ScreenDimensions& screen);
+    // Whether any of 'viewport' needs to be drawn again.
+    bool intersects(const FrameDamage& damage, const Render::RenderViewport& viewport);
+} // namespace Damage
\ No newline at end of file
@@ -47,15 +47,21 @@ namespace Glew
         return "unknown";
     }
 
-    template <typename Reporter>
-    inline ShaderHandle compile_shader(ShaderType type, const char* src, Reporter&& reporter)
+    // Note: With 'KHR_parallel_shader_compile' the driver may still be compiling when this returns.  Querying the
+    // result (see 'check_shader') waits for it.
+    inline ShaderHandle submit_shader(ShaderType type, const char* src)
     {
         ShaderHandle handle { glCreateShader(rep(type)) };
         if (not handle)
             return { };
         glShaderSource(handle.handle(), 1, &src, nullptr);
         glCompileShader(handle.handle());
+        return handle;
+    }
 
+    template <typename Reporter>
+    inline bool check_shader(const ShaderHandle& handle, ShaderType type, Reporter&& reporter)
+    {
         // Check for compilation errors.
         GLint success = GL_FALSE;
         glGetShaderiv(handle.handle(), GL_COMPILE_STATUS, &success);
@@ -68,8 +74,17 @@ namespace Glew
             reporter(txt);
             txt = std::format("{:.{}}", log, len);
             reporter(txt);
-            return { };
+            return false;
         }
+        return true;
+    }
+
+    template <typename Reporter>
+    inline ShaderHandle compile_shader(ShaderType type, const char* src, Reporter&& reporter)
+    {
+        auto handle = submit_shader(type, src);
+        if (not handle or not check_shader(handle, type, reporter))
+            return { };
         return handle;
     }
 
@@ -99,11 +114,15 @@ namespace Glew
         return std::move(program);
     }
 
-    template <typename Reporter>
-    inline bool link_program(ProgramHandle prog, Reporter&& reporter)
+    // Note: Like 'submit_shader', the link may still be in progress when this returns.
+    inline void submit_link(ProgramHandle prog)
     {
         glLinkProgram(rep(prog));
+    }
 
+    template <typename Reporter>
+    inline bool check_program(ProgramHandle prog, Reporter&& reporter)
+    {
         GLint success = 0;
         glGetProgramiv(rep(prog), GL_LINK_STATUS, &success);
         if (not success)
@@ -118,6 +137,13 @@ namespace Glew
         return true;
     }
 
+    template <typename Reporter>
+    inline bool link_program(ProgramHandle prog, Reporter&& reporter)
+    {
+        submit_link(prog);
+        return check_program(prog, reporter);
+    }
+
     enum class UniformHandle : GLint { };
 
 } // namespace Glew
\ No newline at end of file
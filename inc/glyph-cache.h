@@ -95,6 +95,20 @@ namespace Glyph
 
         // For when the renderer updates.
         void bind_primary_texture();
+        // Lets glyphs share a draw with other textured quads (see 'SceneRenderer::select_texture').
+        void select_primary_texture(Render::SceneRenderer* renderer);
+        // Changes whenever glyphs are added to (or cleared from) the texture, which is when geometry built from
+        // earlier lookups may be stale.
+        uint64_t generation() const;
+
+        // Shared lookups.  Between 'begin_snapshot' and 'end_snapshot' the cached fonts and glyph metrics are
+        // read-only, so any number of threads may measure and render text at once.  Font sizes and glyphs which
+        // are not cached yet are queued instead ('?' and the selected font size stand in for them this frame)
+        // and 'end_snapshot' rasterizes them.  Both must be called on the GL thread while no other thread uses
+        // the atlas.  'end_snapshot' returns whether anything was queued, i.e. whether some text was drawn with
+        // stand-ins and has to be drawn again.
+        void begin_snapshot();
+        bool end_snapshot();
 
     private:
         friend RenderFontContext;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+namespace GPUProfiler
+{
+    // Scopes are timed with GL timestamp queries.  Queries are kept per frame in a double-buffered pool and a
+    // frame's results are read when its pool comes around again; results which are still not available by then
+    // are dropped rather than waited on, so profiling never stalls the pipeline.
+    // Note: Everything here must be used on the GL thread.  Work recorded by 'SceneRenderer' only reaches the
+    // GPU when it is submitted, so a scope measures the submissions it encloses.
+
+    struct ScopeTiming
+    {
+        // Scope names are expected to be string literals.
+        std::string_view name;
+        // Nesting depth of the scope when it was first seen.
+        int depth;
+        // Time spent in the scope in the last resolved frame (scopes opened several times in a frame are summed).
+        float last_ms;
+        // Mean over the last 'average_window' resolved frames in which the scope was seen.
+        float average_ms;
+        int samples;
+    };
+
+    constexpr int average_window = 60;
+
+    // Scopes opened while disabled cost nothing and record nothing.
+    void enable(bool b);
+    bool enabled();
+    // Forgets every timing, e.g. before a benchmark starts measuring.
+    void reset();
+    // Call once per frame on the GL thread, e.g. before presenting.
+    void end_frame();
+
+    // Every scope seen since the last 'reset', in the order they were first opened.
+    std::span<const ScopeTiming> scope_timings();
+    const ScopeTiming* find_scope_timing(std::string_view name);
+    // Frames whose queries were not available in time.
+    int dropped_frames();
+
+    class Scope
+    {
+    public:
+        explicit Scope(std::string_view name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int frame_index;
+        int record;
+    };
+} // namespace GPUProfiler
\ No newline at end of file
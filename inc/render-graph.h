@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "enum-utils.h"
+#include "renderer.h"
+#include "types.h"
+
+namespace Render
+{
+    // A framebuffer as a 'RenderGraph' sees it: the window, a framebuffer the graph was handed, or a transient
+    // target which the graph allocates for as long as its passes need it.
+    enum class GraphTarget : int
+    {
+        Sentinel = sentinel_for<GraphTarget>
+    };
+
+    struct GraphPass
+    {
+        // Shows up in the GPU profiler.
+        std::string_view name;
+        FragShader shader;
+        GraphTarget input;
+        GraphTarget output;
+        // Bound as the previous pass texture when set.
+        GraphTarget previous = GraphTarget::Sentinel;
+        // Passes overwrite their output by default, so transient outputs are not cleared first.
+        BlendingMode blending = BlendingMode::Replace;
+        float custom_float_value1 = 0.f;
+        float custom_float_value2 = 0.f;
+    };
+
+    // Full screen passes described by what they read and write rather than by the framebuffers they happen to
+    // use.  When it runs, the graph:
+    // - skips passes whose output nothing reads (the window and imported framebuffers always count as read),
+    // - acquires a framebuffer for a transient target right before its first write and releases it right after
+    //   its last read, so targets which are not alive at the same time share framebuffers,
+    // - invalidates a transient target instead of clearing it when the pass overwrites all of it,
+    // - draws passes into reduced targets (see 'TargetScale') at the reduced resolution.
+    class RenderGraph
+    {
+    public:
+        struct Data;
+
+        RenderGraph();
+        ~RenderGraph();
+
+        GraphTarget import_window();
+        GraphTarget import_framebuffer(Framebuffer fb);
+        GraphTarget create_target(TargetScale scale = TargetScale::Full);
+        // Passes run in the order they are added.
+        void add_pass(const GraphPass& pass);
+
+        // Note: This leaves the vert shader set to 'NoTransform' and the blending mode to that of the last pass.
+        void execute(SceneRenderer* renderer, const ScreenDimensions& screen);
+        // How many passes the last 'execute' skipped.
+        int culled_passes() const;
+
+    private:
+        std::unique_ptr<Data> data;
+    };
+} // namespace Render
\ No newline at end of file
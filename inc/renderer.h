@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <string_view>
 
 #include "types.h"
@@ -17,9 +18,13 @@ namespace Render
     {
         BasicColor,
         SolidCircle,
+        // Anti-aliases the edges of 'SceneRenderer::line' and 'SceneRenderer::polyline'.
+        Line,
         Image,
         Text,
         Icon,
+        // Shades every quad by the 'UIMaterial' stamped into it, so the primitives a widget is made of share draws.
+        UI,
         BasicHSV,
         BasicFade,
         BasicTextureBlend,
@@ -33,6 +38,9 @@ namespace Render
         CRTEasymodeThresh,     // #4
         CRTEasymodeHalation,   // #5
         // End - multi-pass shaders for CRT-Easymode-Halation
+        // Halves and doubles the resolution of a blur pyramid (see 'Effects::BlurQuality').
+        DualKawaseDown,
+        DualKawaseUp,
         Count
     };
 
@@ -118,7 +126,7 @@ namespace Render
     class ScopedRenderViewportScissor
     {
     public:
-        ScopedRenderViewportScissor(RenderViewport old);
+        ScopedRenderViewportScissor(RenderViewport old, SceneRenderer* renderer);
         ~ScopedRenderViewportScissor();
 
         void apply_viewport(RenderViewport viewport);
@@ -133,6 +141,7 @@ namespace Render
         RenderViewport current;
         RenderViewport old_viewport;
         bool old_scissor;
+        SceneRenderer* renderer;
     };
 
     enum class ScissorOffsetX : int { };
@@ -164,12 +173,19 @@ namespace Render
     {
         _0,
         Default = _0,
-        _1,
-        _2,
+        Count
+        // Intermediate targets are acquired from 'SceneRenderer::acquire_framebuffer' (or a 'RenderGraph') and come
+        // after 'Count'.
+    };
 
-        // These buffers are never reserved.
-        Scratch1 = _1,
-        Scratch2 = _2,
+    // The resolution of a framebuffer from 'SceneRenderer::acquire_framebuffer', relative to the screen.
+    enum class TargetScale
+    {
+        Full,
+        Half,
+        Quarter,
+        Eighth,
+        Sixteenth,
         Count
     };
 
@@ -227,6 +243,162 @@ namespace Render
         PremultipliedAlpha, // GL_ONE, GL_ONE_MINUS_SRC_ALPHA
         SrcAlpha,           // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA
         Default,            // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+        Replace,            // GL_ONE, GL_ZERO
+    };
+
+    // How vertices are laid out in the vertex buffer.  This is fixed at 'SceneRenderer::init'.
+    enum class VertexLayout
+    {
+        // 32 bytes: float position, float RGBA color, float UV.
+        Standard,
+        // 16 bytes: float position, RGBA8 color, snorm16 UV.
+        Compact,
+        Count
+    };
+
+    // How quads ('solid_rect', 'render_image', 'solid_circle', and therefore glyphs) are submitted.
+    enum class QuadSubmission
+    {
+        // Four vertices per quad, expanded to triangles through an index buffer.
+        PerVertex,
+        // One instance record per quad, expanded to a quad by the vertex shader.
+        Instanced,
+    };
+
+    // How 'FragShader::UI' shades a quad.  Other shaders ignore the material.
+    enum class UIMaterial
+    {
+        // The quad color.  Anything drawn without a material is solid.
+        Solid,
+        // A rect with anti-aliased rounded corners, which is a circle when the radius is half its size.
+        RoundedRect,
+        // Glyph coverage, as 'FragShader::Text'.
+        Glyph,
+        // Texels as they are, as 'FragShader::Image'.
+        Image,
+        // Black texels take the quad color, as 'FragShader::Icon'.
+        Icon,
+        Count
+    };
+
+    // Counters collected by the renderer over a single frame.  See 'SceneRenderer::end_frame'.
+    struct FrameStats
+    {
+        // Vertex streaming.
+        // How many times the vertex ring moved on to its next segment.
+        int vertex_segment_advances = 0;
+        // How many times the CPU had to block because the GPU was still reading a ring segment.
+        int fence_waits = 0;
+        float fence_wait_ms = 0.f;
+        // Vertices and quad instances copied into the streams (or dropped, see 'SceneRenderer::init_without_gl').
+        int elements_streamed = 0;
+
+        // Command recording.
+        // Draws recorded by 'flush' while recording.
+        int draws_recorded = 0;
+        // Draws issued for those after merging compatible commands.
+        int draws_submitted = 0;
+
+        // Texture slots.
+        // Flushes forced by 'select_texture'.
+        int texture_flushes = 0;
+        // Texture changes which found a slot while a batch was pending, i.e. flushes we did not need.
+        int texture_flushes_avoided = 0;
+
+        // Batches.
+        // Vertices built by the renderers.  An instanced quad counts as the four vertices its shader expands.
+        int vertices_emitted = 0;
+        // 'flush' calls which had a batch to flush.
+        int flushes = 0;
+        // Draw calls issued to GL, whatever the path.
+        int gl_draws = 0;
+        // Draws split off because a stream segment filled up in the middle of a batch.  Renderers never flush for
+        // lack of room (their arenas grow), so this is the only way the vertex cap forces a draw.
+        int cap_forced_draws = 0;
+        // 'set_shader' calls which changed the selected shader.
+        int shader_switches = 0;
+
+        // Bindings and uploads.
+        // Textures bound in GL, including those bound to replay recorded draws.  A slot which already holds the
+        // texture is not bound again.
+        int texture_binds = 0;
+        // Textures renderers selected into a slot, including those of recorded draws which were merged away.
+        int texture_bind_requests = 0;
+        int framebuffer_binds = 0;
+        // Framebuffers handed out by 'SceneRenderer::acquire_framebuffer'.
+        int framebuffers_acquired = 0;
+        // Framebuffers whose attachments were (re)created.  This happens the first time one is used after the
+        // screen outgrew (or shrank well below) the size they were allocated at.
+        int render_target_allocations = 0;
+        // Bytes uploaded by 'submit_glyph_data' and 'submit_basic_texture_data'.
+        int texture_upload_bytes = 0;
+
+        // Retained geometry.
+        // Quads drawn from 'RetainedGeometry', none of which were built or streamed this frame.
+        int retained_quads = 0;
+        // Bytes uploaded when retained geometry was captured again.
+        int retained_upload_bytes = 0;
+
+        // Cached layers.
+        // Layers drawn as a single quad, and how many of those had to be drawn again first.
+        int layers_composited = 0;
+        int layers_redrawn = 0;
+    };
+
+    // Counters for how the shader programs were built since 'SceneRenderer::init'.  Programs are built the first
+    // time they are used, so these keep growing for a while after startup.
+    struct ProgramStats
+    {
+        // Vertex and fragment shaders compiled.  Each is compiled at most once, however many programs use it.
+        int stages_compiled = 0;
+        // Programs linked from compiled stages, and programs loaded from the program cache instead.
+        int programs_linked = 0;
+        int programs_loaded = 0;
+        // Time spent on the above.
+        float build_ms = 0.f;
+        // Whether the driver compiles in the background (see 'KHR_parallel_shader_compile').
+        bool parallel_compile = false;
+    };
+
+    // Quads captured once by a renderer and drawn again on later frames without being rebuilt (see
+    // 'SceneRenderer::begin_retained_geometry').
+    class RetainedGeometry
+    {
+    public:
+        struct Data;
+
+        RetainedGeometry();
+        ~RetainedGeometry();
+
+        bool empty() const;
+
+    private:
+        friend SceneRenderer;
+
+        std::unique_ptr<Data> data;
+    };
+
+    // A screen-sized render texture which keeps what was drawn into it until it is invalidated, so that something
+    // which rarely changes (an overlay, for instance) is drawn as a single quad (see
+    // 'SceneRenderer::begin_cached_layer').  Layers are invalidated on their own when the screen is resized and
+    // when shaders are reloaded.
+    class CachedLayer
+    {
+    public:
+        struct Data;
+
+        CachedLayer();
+        ~CachedLayer();
+
+        // The next 'begin_cached_layer' draws the layer again.
+        void invalidate();
+        // Invalidates every layer, e.g. when the theme changes.
+        static void invalidate_all();
+
+    private:
+        friend SceneRenderer;
+
+        std::unique_ptr<Data> data;
     };
 
     // Note: This basic renderer always renders 'up', e.g. a y-coordinate will correspond to the bottom
@@ -239,14 +411,51 @@ namespace Render
         SceneRenderer();
         ~SceneRenderer();
 
-        // Initialize global data for all renderer instances.
-        static bool init(const ScreenDimensions& screen);
-        // Reloads all shaders for every renderer instance.
+        // Initialize global data for all renderer instances.  When 'program_cache_dir' is given (and the driver
+        // supports it), linked programs are saved there and loaded back on later runs instead of being compiled.
+        // 'parallel_compile' = false keeps programs from building in the background even if the driver could.
+        static bool init(const ScreenDimensions& screen,
+                         VertexLayout layout = VertexLayout::Standard,
+                         std::string_view program_cache_dir = { },
+                         bool parallel_compile = true);
+        // Initialize without a GL context, which lets the CPU side be measured on its own (see the benchmarks).
+        // Geometry is built, recorded, and merged as usual but dropped where it would be drawn, and the frame
+        // stats count it as if it were drawn.  Only the glyph texture functions of the texture functions below may
+        // be used.
+        static void init_without_gl(VertexLayout layout = VertexLayout::Standard);
+        // Builds every shader program now and waits for all of them, which is what startup did before programs
+        // were built the first time they are used.  Only there to measure startup against.
+        static void build_all_programs();
+        // Reloads all shaders for every renderer instance.  The new programs are built in the background (see
+        // 'poll_program_builds') and replace the current ones only once all of them have built, so 'feed' has to
+        // outlive the reload.
         static void reload_shaders(const std::string_view asset_core_path, Feed::MessageFeed* feed);
+        // Checks the shader files under 'asset_core_path' for changes every so often and reloads just the files
+        // which changed, once they have been left alone for a moment, along the lines of 'reload_shaders'.  Call
+        // this once per iteration of the main loop.
+        static void watch_shaders(std::string_view asset_core_path, Feed::MessageFeed* feed);
+        // Picks up shader programs which finished building in the background.  Call this once per iteration of the
+        // main loop, whether or not anything is drawn.  Returns true when a shader reload replaced the programs in
+        // use, which means everything has to be drawn again.
+        static bool poll_program_builds();
+        // Marks the end of a frame for all renderer instances.  This should be called before presenting.
+        static void end_frame();
+        // The counters of the last frame completed by 'end_frame'.
+        static const FrameStats& frame_stats();
+        static const ProgramStats& program_stats();
 
         // Functions for interacting with the framebuffer.
+        // Note: Framebuffers are allocated lazily, in steps rather than at the exact size of the screen, and drawn
+        // into from their lower left corner.  Sample them through 'render_framebuffer' or 'bind_framebuffer_texture'
+        // and a shader which accounts for 'framebuffer_uv_scale'.
         static void screen_resize(const ScreenDimensions& screen);
         void bind_framebuffer(Framebuffer idx);
+        // A framebuffer the size of the screen from a pool shared by all renderers, for passes which need scratch
+        // space.  It can be used like the named framebuffers until it is released.  The contents do not survive
+        // being released.
+        // Note: A reduced 'scale' is drawn into with a viewport reduced to match.
+        static Framebuffer acquire_framebuffer(TargetScale scale = TargetScale::Full);
+        static void release_framebuffer(Framebuffer fb);
         // Back to default render buffer.
         void unbind_framebuffer();
         void enable_prev_pass_texture(Framebuffer prev);
@@ -256,11 +465,10 @@ namespace Render
         // possible postprocessing on the resulting framebuffer.
         void render_framebuffer(const ScreenDimensions& screen, Framebuffer src);
         void bind_framebuffer_texture(Framebuffer src);
-        // Using framebuffer 'src', render that framebuffer to framebuffer 'dest' using the provided fragment shader.
-        // Note: This will make the blend mode sticky, be sure to unset it, if necessary.
-        void render_framebuffer_layer(FramebufferIO io, FragShader shader, const ScreenDimensions& full_screen);
-        // Similar to the above, but it does not clear framebuffer content first.
-        void render_framebuffer_layer_noclear(FramebufferIO io, FragShader shader, const ScreenDimensions& full_screen);
+        // Confines everything drawn into 'Framebuffer::Default' (clears included) to 'region', on top of any scissor in
+        // effect, so that only a damaged part of the previous frame is drawn again.  Other framebuffers are unaffected.
+        static void clip_to_damage(const ScissorRegion& region);
+        static void remove_damage_clip();
 
         // Functions for creating render textures and rendering them.
         static RenderTexture create_render_texture(const ScreenDimensions& screen);
@@ -282,10 +490,64 @@ namespace Render
         // Note: This API assumes the texture is bound.
         static void submit_glyph_data(GlyphTexture tex, GlyphEntry entry);
 
+        // Texture slots.  Selecting a texture binds it to one of several texture units and stamps the slot into
+        // the following image quads, so quads sampling different textures can share a draw.  Slots are only
+        // carried by 'QuadSubmission::Instanced'; the per-vertex path flushes and binds texture unit 0 instead.
+        // Note: Binding a texture through the functions above selects slot 0 again.
+        void select_texture(BasicTexture tex);
+        void select_texture(GlyphTexture tex);
+
+        // Command recording.  While recording, 'flush' records the pending batch along with the current shaders,
+        // inputs, texture, viewport, scissor, and blending instead of drawing it.  Recorded commands are merged
+        // and drawn when recording ends or right before anything that depends on their results (framebuffer
+        // binds, clears, and texture updates).
+        // Every renderer builds its geometry in its own arena, so several renderers can record at once.  Their
+        // commands are submitted together, one renderer after the other in the order they began recording, when
+        // the last of them ends.
+        // A recording renderer takes a copy of the texture, viewport, scissor, and blending state when it begins
+        // and works on that copy alone, so its viewports, texture selection, and blending mode never reach GL
+        // until its commands are drawn (nor outlive the recording).  Between 'begin_command_recording' and
+        // 'end_command_recording' (both of which must be called on the GL thread) a renderer may therefore be
+        // driven from another thread as long as only the functions under "User interaction", "Rendering",
+        // "Various inputs for shaders", 'select_texture', and 'apply_blending_mode' are used there; every
+        // renderer recording on another thread must be done before anything submits.
+        void begin_command_recording();
+        void end_command_recording();
+
+        // Retained geometry.  Between 'begin_retained_geometry' and 'end_retained_geometry' the quads a renderer
+        // builds are captured into 'geometry' (replacing what it held) instead of being drawn, along with the
+        // textures they sample.  'draw_retained_geometry' then draws them moved by 'offset' from a buffer of their
+        // own, so content which only scrolls is built once.  The shaders and blending are whichever are current
+        // when it is drawn.
+        // Only 'QuadSubmission::Instanced' quads can be captured; 'begin_retained_geometry' returns false for any
+        // other renderer and the geometry should be drawn directly instead.  Capturing and drawing work while
+        // recording (on any thread), but the geometry must not be captured again until its recorded draws are
+        // submitted.
+        // Note: Drawing retained geometry may rebind texture slots, so select the texture again afterwards.
+        bool begin_retained_geometry(RetainedGeometry* geometry);
+        void end_retained_geometry();
+        void draw_retained_geometry(const RetainedGeometry& geometry, const Vec2f& offset);
+
+        // Cached layers.  'begin_cached_layer' returns true when 'layer' has to be drawn again, in which case
+        // everything up to 'end_cached_layer' is drawn into it (cleared to transparent first) instead of the bound
+        // framebuffer, which is bound again afterwards.  Otherwise nothing needs drawing and 'end_cached_layer' must
+        // not be called.  Either way, 'composite_cached_layer' then draws the layer over the bound framebuffer.
+        // Note: The layer is drawn with 'BlendingMode::SrcAlpha' so it holds premultiplied colors, and compositing
+        // sets the vert and frag shaders.
+        bool begin_cached_layer(CachedLayer* layer, const ScreenDimensions& screen);
+        void end_cached_layer(CachedLayer* layer);
+        void composite_cached_layer(const CachedLayer& layer);
+
         // User interaction.
         void flush();
         void set_shader(FragShader shader);
         void set_shader(VertShader shader);
+        FragShader selected_frag_shader() const;
+        // Note: Custom geometry (lines and triangles) always uses the per-vertex path.
+        void quad_submission(QuadSubmission mode);
+        // Whether quads carry their 'UIMaterial' (see 'ui_rounded_rect'), which only 'QuadSubmission::Instanced'
+        // does.  Without them 'FragShader::UI' draws every quad solid, so widgets use the per-primitive shaders.
+        bool ui_materials() const;
         ScopedRenderViewport create_viewport(const ScreenDimensions& screen);
         ScopedRenderViewport create_viewport(const RenderViewport& viewport);
         ScopedRenderViewportScissor create_scissor_viewport(const ScreenDimensions& screen);
@@ -295,10 +557,25 @@ namespace Render
         void solid_rect(const Vec2f& top_left, const Vec2f& size, const Vec4f& color);
         void strike_rect(const Vec2f& top_left, const Vec2f& size, float thickness, const Vec4f& color);
         void solid_circle(const Vec2f& center, float radius, const Vec4f& color);
-        // Note: Because line is a different kind of primitive, they are flushed immediately.
+        // Note: Triangles are not indexed, so mixing them with quads will break the batch.
+        void solid_triangle(const Vec2f& p0, const Vec2f& p1, const Vec2f& p2, const Vec4f& color);
+        // Lines are expanded into indexed quads, so consecutive lines drawn under 'FragShader::Line' (which
+        // anti-aliases their edges) go out in one draw.
         void line(const Vec2f& a, const Vec2f& b, float thickness, const Vec4f& color);
+        // Connected segments through 'points', mitered where they meet.
+        void polyline(std::span<const Vec2f> points, float thickness, const Vec4f& color);
         void render_image(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color);
 
+        // UI materials.  These stamp a 'UIMaterial' into the quad so that under 'FragShader::UI' rects, rounded rects,
+        // circles, glyphs, images, and icons can all go out in a single draw (as long as their textures fit in the
+        // texture slots).  Under any other shader they draw as 'solid_rect' and 'render_image' would.
+        // Note: Materials are only carried by 'QuadSubmission::Instanced', see 'ui_materials'.
+        void ui_rounded_rect(const Vec2f& top_left, const Vec2f& size, float radius, const Vec4f& color);
+        void ui_circle(const Vec2f& center, float radius, const Vec4f& color);
+        void ui_glyph(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color);
+        void ui_image(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color);
+        void ui_icon(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color);
+
         // Various inputs for shaders.
         const Camera& camera() const;
         void camera(const Camera& new_camera);
@@ -315,9 +592,16 @@ namespace Render
 
         // Various buffer operations.
         void reset_current_buffer(const Vec4f& color);
+        // For a pass about to overwrite every pixel: the current contents can be thrown away, which is cheaper
+        // than clearing them.  Clears instead when the driver cannot invalidate.
+        // Note: This ignores the damage clip so it is not meant for 'Framebuffer::Default'.
+        void invalidate_current_buffer();
         void apply_blending_mode(BlendingMode mode);
 
     private:
+        friend ScopedRenderViewport;
+        friend ScopedRenderViewportScissor;
+
         void gather_vertices();
         void populate_buffer();
         void draw();
@@ -326,13 +610,30 @@ namespace Render
     };
 
     // Helper functions.
+    // How many times smaller 'scale' is than the screen.
+    int downscale_factor(TargetScale scale);
     // Note: This will set the vert and frag shaders so callers need to remember to set their shaders after.
     void draw_background(SceneRenderer* renderer, const ScreenDimensions& screen, const Vec4f& color);
 
     namespace Effects
     {
-        void text_glow(FramebufferIO io, SceneRenderer* renderer, const RenderViewport& viewport, const ScreenDimensions& full_screen);
-        void apply_text_glow_to(RenderTexture in, SceneRenderer* renderer, const ScreenDimensions& full_screen);
-        void blur_background(FramebufferIO io, SceneRenderer* renderer, const RenderViewport& viewport, const ScreenDimensions& full_screen);
+        // How a blur is computed.  Every tier other than 'FullResolution' downsamples into a pyramid of smaller
+        // targets and blurs on the way back up, so the cost mostly stops scaling with the screen.
+        enum class BlurQuality
+        {
+            // Two separable Gaussian passes over the whole screen.
+            FullResolution,
+            // Pyramid down to 1/4 resolution.
+            Low,
+            // Pyramid down to 1/8 resolution.
+            Medium,
+            // Pyramid down to 1/16 resolution.  The widest and smoothest of the tiers.
+            High,
+            Count
+        };
+
+        void text_glow(FramebufferIO io, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality = BlurQuality::Medium);
+        void apply_text_glow_to(RenderTexture in, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality = BlurQuality::Medium);
+        void blur_background(FramebufferIO io, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality = BlurQuality::Medium);
     } // namespace Effects
 } // namespace Render
\ No newline at end of file
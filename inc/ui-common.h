@@ -30,6 +30,8 @@ namespace UI
         ShowGlyphs       = 1u << 0,
         SuspendRendering = 1u << 1,
         ShowFPS          = 1u << 2,
+        ShowGPUTimings   = 1u << 3,
+        ShowRenderStats  = 1u << 4,
     };
 
     struct UIState
@@ -15,12 +15,16 @@ Errno save_file(std::string_view file_path, const std::string& buf);
 bool file_exists(std::string_view file_path);
 bool regular_file(std::string_view file_path);
 bool dir_exists(std::string_view dir_path);
+// When the file was last written, in ticks of the file system's clock.  Zero if that cannot be read.
+uint64_t file_write_time(std::string_view file_path);
 std::string working_dir();
 Errno set_working_dir(const char* file_path);
 std::string combine_paths(std::string_view a, std::string_view b);
 std::string_view filename(std::string_view path);
 std::string default_font_path(std::string_view core_asset_path);
 std::string default_config_directory();
+// Created if it does not exist yet.
+std::string default_program_cache_directory();
 
 using FilesInDirResult = std::vector<std::string>;
 void files_in_dir(std::string_view dir, FilesInDirResult* result, std::string_view ext_filter = { });
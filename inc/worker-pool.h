@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace Workers
+{
+    using Job = std::function<void()>;
+
+    // A fixed set of threads which run queued jobs in no particular order.
+    class WorkerPool
+    {
+    public:
+        struct Data;
+
+        WorkerPool();
+        ~WorkerPool();
+
+        // Starts 'count' threads.  Only call this once.
+        void init(int count);
+
+        void submit(Job job);
+        // Blocks until every submitted job has run.
+        void wait();
+
+    private:
+        std::unique_ptr<Data> data;
+    };
+
+    // One thread is left for the caller, which keeps working while the pool runs.
+    int default_worker_count();
+} // namespace Workers
\ No newline at end of file
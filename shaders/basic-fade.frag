@@ -1,6 +1,13 @@
 #version 330 core
 
-uniform float time;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+};
 
 in vec4 out_color;
 in vec2 out_uv;
@@ -1,7 +1,16 @@
 #version 330 core
 
 uniform sampler2D image;
-uniform vec2 resolution;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+    // The part of a render target the screen covers, see 'render_target_extent'.
+    vec2 framebuffer_uv_scale;
+};
 uniform float custom_float_value1;
 uniform float custom_float_value2;
 
@@ -21,17 +30,20 @@ vec4 blur_vert(vec2 tex, sampler2D s0, vec2 texture_size)
     vec4 col = vec4(0.0);
     float dy = 1.0 / texture_size.y;
 
+    vec2 uv_max = framebuffer_uv_scale - 0.5 / texture_size;
     float k_total = 0.0;
     for (int i = -TAPS; i <= TAPS; i++)
     {
         float k = kernel(i);
         k_total += k;
-        col += k * texture(s0, tex + vec2(0.0, float(i) * dy));
+        // Taps past the edge of the screen would pick up whatever is in the rest of the target.
+        col += k * texture(s0, min(tex + vec2(0.0, float(i) * dy), uv_max));
     }
     return vec4(col / k_total);
 }
 
 void main()
 {
-    frag_color = blur_vert(out_uv, image, resolution);
+    // Render targets are larger than the screen, and possibly reduced, so step by texels of the texture itself.
+    frag_color = blur_vert(out_uv, image, vec2(textureSize(image, 0)));
 }
\ No newline at end of file
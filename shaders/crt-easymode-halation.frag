@@ -97,8 +97,16 @@ uniform float SHARPNESS_V;
 
 uniform sampler2D image;
 uniform sampler2D prev_pass_tex;
-uniform float time;
-uniform vec2 resolution;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+    // The part of a render target the screen covers, see 'render_target_extent'.
+    vec2 framebuffer_uv_scale;
+};
 
 in vec2 out_uv;
 
@@ -107,7 +115,8 @@ out vec4 frag_color;
 #define FIX(c) max(abs(c), 1e-5)
 #define PI 3.141592653589
 
-#define TEX2D(c) dilate(texture(tex, c))
+// Coordinates below are over the screen, which may only cover part of the render target.
+#define TEX2D(c) dilate(texture(tex, (c) * framebuffer_uv_scale))
 
 vec4 dilate(vec4 col)
 {
@@ -248,7 +257,7 @@ vec4 crt_easymode_halation(sampler2D tex, vec2 coords, vec2 texture_size, vec2 v
     color_matrix[3] = filter_lanczos(coeffs_x, get_color_matrix(PASSPREV4, tex_co + 2.0 * dy, dx));
 
     col = filter_lanczos(coeffs_y, color_matrix).rgb;
-    diff = texture(tex, xy).rgb;
+    diff = texture(tex, xy * framebuffer_uv_scale).rgb;
 
     float rgb_max = max(col.r, max(col.g, col.b));
     float sample_offset = (video_size.y / output_size.y) * 0.5;
@@ -321,5 +330,5 @@ vec4 crt_easymode_halation(sampler2D tex, vec2 coords, vec2 texture_size, vec2 v
 void main()
 {
     //return crt_easymode_halation(image, out_uv, resolution, resolution, COMPAT_output_size, COMPAT_frame_count, PASSPREV_texture(4));
-    frag_color = crt_easymode_halation(image, out_uv, resolution, resolution, resolution, /* frame_count? */time, prev_pass_tex);
+    frag_color = crt_easymode_halation(image, out_uv / framebuffer_uv_scale, resolution, resolution, resolution, /* frame_count? */time, prev_pass_tex);
 }
\ No newline at end of file
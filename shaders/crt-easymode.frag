@@ -3,7 +3,16 @@
 // This is largely the crt-easymode shader found at https://github.com/libretro/glsl-shaders/blob/master/crt/shaders/crt-easymode.glsl.
 
 uniform sampler2D image;
-uniform vec2 resolution;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+    // The part of a render target the screen covers, see 'render_target_extent'.
+    vec2 framebuffer_uv_scale;
+};
 
 in vec2 out_uv;
 
@@ -18,7 +27,8 @@ out vec4 frag_color;
 #define InputSize resolution
 #define Texture image
 
-#define COMPAT_TEXTURE texture
+// Coordinates below are over the screen, which may only cover part of the render target.
+#define COMPAT_TEXTURE(t, c) texture(t, (c) * framebuffer_uv_scale)
 
 #if 0
 uniform COMPAT_PRECISION vec2 OutputSize;
@@ -35,7 +45,7 @@ COMPAT_VARYING vec4 TEX0;
 
 // compatibility #defines
 #define Source Texture
-#define vTexCoord out_uv
+#define vTexCoord (out_uv / framebuffer_uv_scale)
 
 #define SourceSize vec4(TextureSize, 1.0 / TextureSize) //either TextureSize or InputSize
 #define outsize vec4(OutputSize, 1.0 / OutputSize)
@@ -9,7 +9,16 @@
 
 // Samplers
 uniform sampler2D image;
-uniform vec2 resolution;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+    // The part of a render target the screen covers, see 'render_target_extent'.
+    vec2 framebuffer_uv_scale;
+};
 
 in vec2 out_uv;
 
@@ -55,8 +64,9 @@ vec4 vignetteIntensity(vec2 uv, vec2 resolution, float opacity, float roundness)
 
 void main()
 {
-    vec2 remappedUV = curveRemapUV(vec2(out_uv.x, out_uv.y));
-    vec4 baseColor = texture2D(image, remappedUV);
+    // The curve is computed over the screen, which may only cover part of the render target.
+    vec2 remappedUV = curveRemapUV(out_uv / framebuffer_uv_scale);
+    vec4 baseColor = texture2D(image, remappedUV * framebuffer_uv_scale);
 
     baseColor *= vignetteIntensity(remappedUV, resolution, vignetteOpacity, vignetteRoundness);
 
@@ -0,0 +1,43 @@
+#version 330 core
+
+// Dual Kawase blur, see "Bandwidth-Efficient Rendering" (Marius Bjorge, SIGGRAPH 2015).  Each pass of the
+// downsample halves the resolution and each pass of the upsample doubles it again, so a wide blur costs a few
+// small passes rather than many full resolution taps.
+
+uniform sampler2D image;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+    // The part of a render target the screen covers, see 'render_target_extent'.
+    vec2 framebuffer_uv_scale;
+};
+uniform float custom_float_value1;
+
+in vec2 out_uv;
+
+out vec4 frag_color;
+
+// How far apart the taps are, in texels.
+#define OFFSET custom_float_value1
+
+// Taps past the edge of the screen would pick up whatever is in the rest of the target.
+vec4 tap(vec2 uv, vec2 texel)
+{
+    return texture(image, clamp(uv, 0.5 * texel, framebuffer_uv_scale - 0.5 * texel));
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec2 half_texel = 0.5 * texel * OFFSET;
+    vec4 sum = tap(out_uv, texel) * 4.0;
+    sum += tap(out_uv - half_texel, texel);
+    sum += tap(out_uv + half_texel, texel);
+    sum += tap(out_uv + vec2(half_texel.x, -half_texel.y), texel);
+    sum += tap(out_uv - vec2(half_texel.x, -half_texel.y), texel);
+    frag_color = sum / 8.0;
+}
\ No newline at end of file
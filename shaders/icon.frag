@@ -1,14 +1,29 @@
 #version 330 core
 
-uniform sampler2D image;
+uniform sampler2D texture_slots[8];
 
 in vec4 out_color;
 in vec2 out_uv;
+flat in int out_texture_slot;
 
 out vec4 frag_color;
 
+// Note: sampler arrays can only be indexed by constant expressions here.
+vec4 sample_texture_slot(vec2 uv) {
+    switch (out_texture_slot) {
+    case 1: return texture(texture_slots[1], uv);
+    case 2: return texture(texture_slots[2], uv);
+    case 3: return texture(texture_slots[3], uv);
+    case 4: return texture(texture_slots[4], uv);
+    case 5: return texture(texture_slots[5], uv);
+    case 6: return texture(texture_slots[6], uv);
+    case 7: return texture(texture_slots[7], uv);
+    default: return texture(texture_slots[0], uv);
+    }
+}
+
 void main() {
-    vec4 texel = texture(image, out_uv);
+    vec4 texel = sample_texture_slot(out_uv);
     bool adjust = texel.rgb == vec3(0, 0, 0) && texel.a > 0;
     vec4 adjusted_color = out_color;
     adjusted_color.a = texel.a;
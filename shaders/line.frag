@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec4 out_color;
+in vec2 out_uv;
+
+out vec4 frag_color;
+
+void main() {
+    // out_uv.y runs from -1 to 1 across the line, which includes half a pixel of feathering on either side.
+    // Fade out over the last pixel of each edge, however wide the line is on screen.
+    float dist = 1.0 - abs(out_uv.y);
+    float coverage = clamp(dist / fwidth(out_uv.y), 0.0, 1.0);
+
+    frag_color = vec4(out_color.rgb, out_color.a * coverage);
+}
@@ -1,25 +1,67 @@
 #version 330 core
 
-uniform vec2 resolution;
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+};
 uniform vec2 custom_vec2_value1;
 uniform vec2 custom_vec2_value2;
 uniform vec2 custom_vec2_value3;
 
+#ifdef INSTANCED_QUADS
+// One record per quad: xy = first corner, zw = size.
+layout(location = 3) in vec4 instance_rect;
+// xy = UV of the first corner, zw = UV of the last corner.
+layout(location = 4) in vec4 instance_uv_rect;
+layout(location = 5) in vec4 instance_color;
+layout(location = 6) in int instance_texture_slot;
+// Moves every quad of a retained draw (see 'SceneRenderer::draw_retained_geometry').
+uniform vec2 geometry_offset;
+#else
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 uv;
+// Per-vertex geometry always samples the texture bound to unit 0.
+const int texture_slot = 0;
+// Nor a material, so 'ui.frag' always fills it solid.
+const int material = 0;
+const vec3 material_params = vec3(0);
+#endif
 
 out vec4 out_color;
 out vec2 out_uv;
+flat out int out_texture_slot;
+// Only read by 'ui.frag'.
+flat out int out_material;
+// xy = half the size of the quad, z = corner radius.
+flat out vec3 out_material_params;
 out vec2 transformed_custom_vec2_value1;
 out vec2 transformed_custom_vec2_value2;
 out vec2 transformed_custom_vec2_value3;
 out vec2 vert_pos;
 
 void main() {
+#ifdef INSTANCED_QUADS
+    // Expand the unit quad (drawn as a strip): 0 - 1, 2 - 3.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 position = instance_rect.xy + geometry_offset + instance_rect.zw * corner;
+    vec2 uv = mix(instance_uv_rect.xy, instance_uv_rect.zw, corner);
+    vec4 color = instance_color;
+    // The texture slot is the low byte, followed by the material and the corner radius in quarter units.
+    int texture_slot = instance_texture_slot & 0xFF;
+    int material = (instance_texture_slot >> 8) & 0xFF;
+    vec3 material_params = vec3(abs(instance_rect.zw) * 0.5, float(instance_texture_slot >> 16) * 0.25);
+#endif
     gl_Position = vec4(position / resolution, 0, 1);
     out_color = color;
     out_uv = uv;
+    out_texture_slot = texture_slot;
+    out_material = material;
+    out_material_params = material_params;
     transformed_custom_vec2_value1 = custom_vec2_value1 / resolution;
     transformed_custom_vec2_value2 = custom_vec2_value2 / resolution;
     transformed_custom_vec2_value3 = custom_vec2_value3 / resolution;
@@ -1,13 +1,35 @@
 #version 330 core
 
-uniform sampler2D image;
-uniform vec2 resolution;
+uniform sampler2D texture_slots[8];
+layout(std140) uniform FrameInputs
+{
+    vec2 resolution;
+    vec2 camera_pos;
+    vec2 camera_scale;
+    float time;
+    float camera_coord_factor;
+};
 
 in vec4 out_color;
 in vec2 out_uv;
+flat in int out_texture_slot;
 
 out vec4 frag_color;
 
+// Note: sampler arrays can only be indexed by constant expressions here.
+vec4 sample_texture_slot(vec2 uv) {
+    switch (out_texture_slot) {
+    case 1: return texture(texture_slots[1], uv);
+    case 2: return texture(texture_slots[2], uv);
+    case 3: return texture(texture_slots[3], uv);
+    case 4: return texture(texture_slots[4], uv);
+    case 5: return texture(texture_slots[5], uv);
+    case 6: return texture(texture_slots[6], uv);
+    case 7: return texture(texture_slots[7], uv);
+    default: return texture(texture_slots[0], uv);
+    }
+}
+
 // Borrowed from: https://stackoverflow.com/questions/1506299/applying-brightness-and-contrast-with-opengl-es
 vec4 adjust_brightness(vec4 color) {
     float bright = 1.25;
@@ -17,7 +39,7 @@ vec4 adjust_brightness(vec4 color) {
 }
 
 void main() {
-    float texel = texture(image, out_uv).r;
+    float texel = sample_texture_slot(out_uv).r;
     vec4 color = vec4(out_color.rgb, texel * out_color.a);
     // Brighten the final result a bit for a more readable text.
     frag_color = adjust_brightness(color);
@@ -0,0 +1,83 @@
+#version 330 core
+
+uniform sampler2D texture_slots[8];
+
+in vec4 out_color;
+in vec2 out_uv;
+flat in int out_texture_slot;
+flat in int out_material;
+// xy = half the size of the quad, z = corner radius.
+flat in vec3 out_material_params;
+
+out vec4 frag_color;
+
+// Keep in sync with 'Render::UIMaterial'.
+const int material_solid = 0;
+const int material_rounded_rect = 1;
+const int material_glyph = 2;
+const int material_image = 3;
+const int material_icon = 4;
+
+// Note: sampler arrays can only be indexed by constant expressions here.
+vec4 sample_texture_slot(vec2 uv) {
+    switch (out_texture_slot) {
+    case 1: return texture(texture_slots[1], uv);
+    case 2: return texture(texture_slots[2], uv);
+    case 3: return texture(texture_slots[3], uv);
+    case 4: return texture(texture_slots[4], uv);
+    case 5: return texture(texture_slots[5], uv);
+    case 6: return texture(texture_slots[6], uv);
+    case 7: return texture(texture_slots[7], uv);
+    default: return texture(texture_slots[0], uv);
+    }
+}
+
+// Same as text.frag.
+vec4 adjust_brightness(vec4 color) {
+    float bright = 1.25;
+    vec4 luminance = vec4(1.0);
+    float contrast = 1.0;
+    return mix(color * bright, mix(luminance, color, contrast), 0.5);
+}
+
+// Distance from 'p' to the edge of a rect centered on the origin whose corners are rounded by 'radius'.
+float rounded_rect_distance(vec2 p, vec2 half_size, float radius) {
+    vec2 q = abs(p) - half_size + radius;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+void main() {
+    // The material is the same for the whole quad, but derivatives are taken up front regardless.
+    vec2 half_size = out_material_params.xy;
+    float radius = min(out_material_params.z, min(half_size.x, half_size.y));
+    float dist = rounded_rect_distance(out_uv * half_size, half_size, radius);
+    float dist_width = max(fwidth(dist), 1e-4);
+
+    switch (out_material) {
+    case material_rounded_rect: {
+        // Fade out over the last pixel of the edge, however large the rect is on screen.
+        float coverage = clamp(0.5 - dist / dist_width, 0.0, 1.0);
+        frag_color = vec4(out_color.rgb, out_color.a * coverage);
+        break;
+    }
+    case material_glyph: {
+        float texel = sample_texture_slot(out_uv).r;
+        frag_color = adjust_brightness(vec4(out_color.rgb, texel * out_color.a));
+        break;
+    }
+    case material_image:
+        frag_color = sample_texture_slot(out_uv);
+        break;
+    case material_icon: {
+        // Black texels take the quad color, as in icon.frag.
+        vec4 texel = sample_texture_slot(out_uv);
+        bool adjust = texel.rgb == vec3(0, 0, 0) && texel.a > 0;
+        vec4 adjusted_color = vec4(out_color.rgb, texel.a);
+        frag_color = mix(texel, adjusted_color, adjust);
+        break;
+    }
+    default:
+        frag_color = out_color;
+        break;
+    }
+}
@@ -3,6 +3,9 @@
 #include <algorithm>
 
 #include "config.h"
+#include "cpu-profiler.h"
+#include "damage.h"
+#include "scope-guard.h"
 
 namespace UI::Widgets
 {
@@ -21,6 +24,7 @@ namespace UI::Widgets
     {
         static constexpr int padding = 2;
         static constexpr float scrollbar_width = 10.f;
+        static constexpr float scrollbar_radius = 3.f;
 
         Vec2f content_size;
         Vec2f scroll_offset;
@@ -88,6 +92,15 @@ namespace UI::Widgets
                 data->ui_data.hover_scroll = true;
             }
         }
+
+        // The scrollbar moves with the offset and changes color on hover, and the offset moves the content.
+        void damage_if_changed(const ScrollBox::Data& data, const Vec2f& old_offset, bool old_hover, const Render::RenderViewport& viewport)
+        {
+            if (data.scroll_offset != old_offset or data.ui_data.hover_scroll != old_hover)
+            {
+                Damage::add(viewport);
+            }
+        }
     } // namespace [anon]
 
     ScrollBox::ScrollBox():
@@ -128,14 +141,18 @@ namespace UI::Widgets
     {
         if (not mouse_in_viewport(mouse_pos, viewport))
             return;
+        const auto old_offset = data->scroll_offset;
         data->scroll_offset.y = std::clamp(data->scroll_offset.y - amount, 0.f, data->content_size.y);
+        damage_if_changed(*data, old_offset, data->ui_data.hover_scroll, viewport);
     }
 
     void ScrollBox::scroll_down(float amount, const Vec2i& mouse_pos, const Render::RenderViewport& viewport)
     {
         if (not mouse_in_viewport(mouse_pos, viewport))
             return;
+        const auto old_offset = data->scroll_offset;
         data->scroll_offset.y = std::clamp(data->scroll_offset.y + amount, 0.f, data->content_size.y);
+        damage_if_changed(*data, old_offset, data->ui_data.hover_scroll, viewport);
     }
 
     void ScrollBox::mouse_down(const UIState& state, const Vec2i& mouse_pos, const Render::RenderViewport&)
@@ -149,12 +166,21 @@ namespace UI::Widgets
     {
         if (dragging(*data) and not implies(state.mouse, MouseState::LDown))
         {
+            const bool old_hover = data->ui_data.hover_scroll;
             end_drag(data.get(), mouse_pos, viewport);
+            damage_if_changed(*data, data->scroll_offset, old_hover, viewport);
         }
     }
 
     void ScrollBox::mouse_move(const UIState& state, const Vec2i& mouse_pos, const Render::RenderViewport& viewport)
     {
+        const auto old_offset = data->scroll_offset;
+        const bool old_hover = data->ui_data.hover_scroll;
+        ScopeGuard damage{ [&]
+        {
+            damage_if_changed(*data, old_offset, old_hover, viewport);
+        } };
+
         if (not implies(state.mouse, MouseState::LDown))
         {
             data->ui_data.hover_scroll = false;
@@ -184,28 +210,28 @@ namespace UI::Widgets
 
     void ScrollBox::render(Render::SceneRenderer* renderer, const Render::RenderViewport& viewport)
     {
+        CPU_PROFILE_SCOPE("ScrollBox::render");
         renderer->set_shader(Render::VertShader::OneOneTransform);
+        // Shaded by material so the border, track, and rounded scrollbar go out in a single draw.  Without
+        // materials the scrollbar is square.
+        renderer->set_shader(renderer->ui_materials() ? Render::FragShader::UI : Render::FragShader::BasicColor);
 
         const auto& colors = Config::widget_colors();
 
         // Border rect for viewport.
         if (data->draw_border)
         {
-            renderer->set_shader(Render::FragShader::BasicColor);
             Vec2f left{ 0.f, 0.f };
             Vec2f size{ rep(viewport.width) + 0.f, rep(viewport.height) + 0.f };
             renderer->strike_rect(left, size, 2.f, colors.scrollbar_track_outline);
-            renderer->flush();
         }
 
         // Vert scroll bar.
         {
-            renderer->set_shader(Render::FragShader::BasicColor);
             // Outline for track.
             Vec2f left{ rep(viewport.width) - Data::scrollbar_width, 0.f };
             Vec2f size{ Data::scrollbar_width, rep(viewport.height) + 0.f };
             renderer->strike_rect(left, size, 2.f, colors.scrollbar_track_outline);
-            renderer->flush();
 
             // Scrollbar rect.
             auto [rect_pos, rect_size] = scrollbar_box(data.get(), viewport);
@@ -214,7 +240,7 @@ namespace UI::Widgets
                 colors.scrollbar_inactive, // Neutral.
                 colors.scrollbar_active    // Hovered.
             };
-            renderer->solid_rect(rect_pos, rect_size, scrollbar_color[data->ui_data.hover_scroll]);
+            renderer->ui_rounded_rect(rect_pos, rect_size, Data::scrollbar_radius, scrollbar_color[data->ui_data.hover_scroll]);
             renderer->flush();
         }
     }
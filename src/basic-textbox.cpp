@@ -1,9 +1,12 @@
 #include "basic-textbox.h"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 
 #include "config.h"
+#include "cpu-profiler.h"
 
 namespace UI::Widgets
 {
@@ -33,6 +36,15 @@ namespace UI::Widgets
         LineStarts line_starts;
         Vec2f offset;
         Glyph::FontSize font_size = Glyph::FontSize{ 18 };
+
+        // The lines around the visible ones, captured once and moved by the offset as the text scrolls.  They are
+        // captured again when the visible lines leave them or when the text, font size, or glyph atlas changes.
+        Render::RetainedGeometry retained;
+        bool retained_valid = false;
+        size_t retained_first_line = 0;
+        size_t retained_last_line = 0;
+        Glyph::FontSize retained_font_size{};
+        uint64_t retained_atlas_generation = 0;
     };
 
     namespace
@@ -69,6 +81,46 @@ namespace UI::Widgets
             auto [first, last] = line_range(data, line);
             return std::string_view{ &data->text[rep(first)], rep(last) - rep(first) };
         }
+
+        // How many lines beyond the visible ones are captured on either side, in viewports.  Scrolling this far
+        // costs nothing but a new offset.
+        constexpr size_t retained_margin_viewports = 2;
+
+        bool retained_lines_usable(BasicTextbox::Data* data, Glyph::Atlas* atlas, size_t first_line, size_t last_line)
+        {
+            return data->retained_valid
+                and data->retained_font_size == data->font_size
+                and data->retained_atlas_generation == atlas->generation()
+                and data->retained_first_line <= first_line
+                and last_line <= data->retained_last_line;
+        }
+
+        // Line 'n' goes just under 'n' lines from the top of the text, so only the offset depends on the viewport.
+        void retain_lines(BasicTextbox::Data* data,
+                            Render::SceneRenderer* renderer,
+                            Glyph::Atlas* atlas,
+                            Glyph::RenderFontContext* font_ctx,
+                            size_t first_line,
+                            size_t last_line)
+        {
+            CPU_PROFILE_SCOPE("BasicTextbox::retain_lines");
+            const auto line_height = static_cast<float>(font_ctx->current_font_line_height());
+            const size_t visible = last_line - first_line;
+            const size_t margin = visible * retained_margin_viewports;
+            data->retained_first_line = first_line - std::min(first_line, margin);
+            data->retained_last_line = std::min(data->line_starts.size(), last_line + margin);
+            Vec2f pos{ 0.f, -line_height * static_cast<float>(data->retained_first_line + 1) };
+            for (size_t line = data->retained_first_line; line != data->retained_last_line; ++line)
+            {
+                font_ctx->render_text(renderer, line_text(data, Line{ line }), pos, Config::system_colors().default_font_color);
+                pos.y -= line_height;
+            }
+            font_ctx->flush(renderer);
+            data->retained_valid = true;
+            data->retained_font_size = data->font_size;
+            // Note: Read after rendering since glyphs may be rasterized along the way.
+            data->retained_atlas_generation = atlas->generation();
+        }
     } // namespace [anon]
 
     BasicTextbox::BasicTextbox():
@@ -80,6 +132,7 @@ namespace UI::Widgets
     {
         data->text = text;
         populate_line_starts(text, &data->line_starts);
+        data->retained_valid = false;
     }
 
     void BasicTextbox::offset(const Vec2f& offset)
@@ -135,6 +188,7 @@ namespace UI::Widgets
 
     void BasicTextbox::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const Render::RenderViewport& viewport)
     {
+        CPU_PROFILE_SCOPE("BasicTextbox::render");
         // Find the first line to render.
         auto font_ctx = atlas->render_font_context(data->font_size);
         Line line = text_start_for_visual_offset(data.get(), &font_ctx);
@@ -142,11 +196,29 @@ namespace UI::Widgets
         if (rep(line) >= data->line_starts.size())
             return;
         auto line_height = font_ctx.current_font_line_height();
-        auto start_y = rep(viewport.height) + fmodf(data->offset.y, static_cast<float>(line_height)) - line_height;
-        Vec2f pos{ 0.f, start_y };
         auto last = data->line_starts.size();
         renderer->set_shader(Render::VertShader::OneOneTransform);
-        renderer->set_shader(Render::FragShader::Text);
+        // Glyphs carry their material, so this matches the rest of the window.
+        renderer->set_shader(renderer->ui_materials() ? Render::FragShader::UI : Render::FragShader::Text);
+
+        // Scrolling only moves the retained lines.
+        const size_t visible_lines = static_cast<size_t>(rep(viewport.height) / line_height) + 2;
+        const size_t last_visible = std::min(last, rep(line) + visible_lines);
+        if (retained_lines_usable(data.get(), atlas, rep(line), last_visible))
+        {
+            renderer->draw_retained_geometry(data->retained, Vec2f{ 0.f, rep(viewport.height) + data->offset.y });
+            return;
+        }
+        if (renderer->begin_retained_geometry(&data->retained))
+        {
+            retain_lines(data.get(), renderer, atlas, &font_ctx, rep(line), last_visible);
+            renderer->end_retained_geometry();
+            renderer->draw_retained_geometry(data->retained, Vec2f{ 0.f, rep(viewport.height) + data->offset.y });
+            return;
+        }
+
+        auto start_y = rep(viewport.height) + fmodf(data->offset.y, static_cast<float>(line_height)) - line_height;
+        Vec2f pos{ 0.f, start_y };
         for (; rep(line) < last; line = extend(line))
         {
             auto txt = line_text(data.get(), line);
@@ -3,6 +3,9 @@
 #include <string>
 
 #include "config.h"
+#include "cpu-profiler.h"
+#include "damage.h"
+#include "scope-guard.h"
 
 namespace UI::Widgets
 {
@@ -341,6 +344,16 @@ namespace UI::Widgets
 
     WindowMouseResult BasicWindow::mouse_move(const UIState& state, const Vec2i& mouse_pos, const Render::RenderViewport& viewport)
     {
+        // The close button is drawn differently while hovered.
+        const bool old_hover_close_button = data->ui_data.hover_close_button;
+        ScopeGuard damage_hover{ [&]
+        {
+            if (data->ui_data.hover_close_button != old_hover_close_button)
+            {
+                Damage::add(viewport);
+            }
+        } };
+
         // Clear state.
         data->ui_data.hover_close_button = false;
 
@@ -352,6 +365,12 @@ namespace UI::Widgets
             result.area = WindowMouseArea::Title;
             result.dragging = true;
             result.move_offset = mouse_move_drag(data.get(), mouse_pos);
+            // Both where the window was and where it goes.
+            auto moved_viewport = viewport;
+            moved_viewport.offset_x = Render::ViewportOffsetX{ result.move_offset.x };
+            moved_viewport.offset_y = Render::ViewportOffsetY{ result.move_offset.y };
+            Damage::add(viewport);
+            Damage::add(moved_viewport);
             return result;
         }
 
@@ -361,6 +380,8 @@ namespace UI::Widgets
             result.area = area_from_resize(data->ui_data.resizing);
             result.resizing = true;
             result.resize_viewport = mouse_move_resize(data.get(), mouse_pos);
+            Damage::add(viewport);
+            Damage::add(result.resize_viewport);
             return result;
         }
 
@@ -389,19 +410,22 @@ namespace UI::Widgets
 
     void BasicWindow::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const Render::RenderViewport& viewport)
     {
+        CPU_PROFILE_SCOPE("BasicWindow::render");
         renderer->set_shader(Render::VertShader::OneOneTransform);
+        // With materials everything below is shaded by material, so the whole window goes out in a single draw.
+        // Otherwise the rects and the text each need their own shader.
+        const bool materials = renderer->ui_materials();
+        renderer->set_shader(materials ? Render::FragShader::UI : Render::FragShader::BasicColor);
 
         const auto& colors = Config::widget_colors();
         // Basic window rect.
         {
-            renderer->set_shader(Render::FragShader::BasicColor);
             Vec2f left{ 0.f, 0.f };
             Vec2f size{ rep(viewport.width) + 0.f, rep(viewport.height) + 0.f };
             // First lets clear the rect.
             renderer->solid_rect(left, size, Config::system_colors().background);
             // Now strike it with the color we want.
             renderer->strike_rect(left, size, 2.f, colors.window_border);
-            renderer->flush();
         }
 
         // Window title bar.
@@ -409,23 +433,23 @@ namespace UI::Widgets
             const float title_bar_start_y = rep(viewport.height) - Data::titlebar_height;
             data->button_size = Data::titlebar_height;
 
-            renderer->set_shader(Render::FragShader::BasicColor);
             Vec2f left{ 0.f, title_bar_start_y };
             Vec2f size{ rep(viewport.width) + 0.f, Data::titlebar_height };
             renderer->solid_rect(left, size, colors.window_title_background);
-            renderer->flush();
 
             // Render the close button hover if necessary.
             if (data->ui_data.hover_close_button)
             {
-                // Reuse the shader from above.
                 auto close_button_rect = close_button_box(*data, viewport);
                 renderer->solid_rect(close_button_rect.pos, close_button_rect.size, colors.window_close_button_hover);
-                renderer->flush();
             }
 
+            if (not materials)
+            {
+                renderer->flush();
+                renderer->set_shader(Render::FragShader::Text);
+            }
             auto font_ctx = atlas->render_font_context(Data::font_size);
-            renderer->set_shader(Render::FragShader::Text);
             // Name.
             Vec2f pos{ Data::padding, 0.f };
             // Center the name.
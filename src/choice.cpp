@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "constants.h"
+#include "cpu-profiler.h"
 #include "enum-utils.h"
 
 namespace Choice
@@ -22,10 +23,71 @@ namespace Choice
         Selection selection{};
         static constexpr float cursor_offset = 0.13f;
 
+        // Holds the background, the reason, and the choices as seen through 'layer_camera'.
+        Render::CachedLayer layer;
+        Render::Camera layer_camera;
+        // Found while drawing the layer.
+        Vec2f selection_pos;
+        float max_line_len = 0.0001f;
+
         static constexpr auto title_font_size = Glyph::FontSize{ 32 };
         static constexpr auto font_size = Glyph::FontSize{ 64 };
     };
 
+    namespace
+    {
+        // Also finds where the selection is and how long the longest choice is, for the camera.
+        void render_choices(Chooser::Data* data, Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions& screen)
+        {
+            // Setup a background so it is easier to see the choices.
+            constexpr Vec4f bg_color = Vec4f(0.f, 0.f, 0.f, 0.85f);
+            Render::draw_background(renderer, screen, bg_color);
+            auto font_ctx = atlas->render_font_context(Chooser::Data::font_size);
+
+            // We don't want to transform any text at the top.
+            renderer->set_shader(Render::VertShader::OneOneTransform);
+            // Render the choice description at the top.
+            {
+                auto title_font_ctx = atlas->render_font_context(Chooser::Data::title_font_size);
+                renderer->set_shader(Render::FragShader::Text);
+                Vec2f pos = Vec2f(10.f, rep(screen.height) - rep(Chooser::Data::title_font_size) - 10.f);
+                constexpr Vec4f color = hex_to_vec4f(0xFFFFFFFF);
+                title_font_ctx.render_text(renderer, data->reason, pos, color);
+                title_font_ctx.flush(renderer);
+            }
+
+            // Similar to the editor, we want camera transforms.
+            renderer->set_shader(Render::VertShader::CameraTransform);
+
+            // Render the selection rect.
+            {
+                renderer->set_shader(Render::FragShader::BasicColor);
+                const auto& selection = data->choices[rep(data->selection)];
+                data->selection_pos = Vec2f(0.f, -(rep(data->selection) + Chooser::Data::cursor_offset) * rep(Chooser::Data::font_size));
+                auto size = font_ctx.measure_text(selection);
+                size.y = static_cast<float>(rep(Chooser::Data::font_size));
+                constexpr auto color = hex_to_vec4f(0x7E8081AA);
+                renderer->solid_rect(data->selection_pos, size, color);
+                renderer->flush();
+            }
+
+            // Render entries.
+            data->max_line_len = 0.0001f;
+            {
+                renderer->set_shader(Render::FragShader::Text);
+                Vec2f line_pos{};
+                for (auto& entry : data->choices)
+                {
+                    constexpr auto color = hex_to_vec4f(0xFFFFFFFF);
+                    auto pos = font_ctx.render_text(renderer, entry, line_pos, color);
+                    line_pos.y -= static_cast<float>(rep(Chooser::Data::font_size));
+                    data->max_line_len = std::max(pos.x, data->max_line_len);
+                }
+                font_ctx.flush(renderer);
+            }
+        }
+    } // namespace [anon]
+
     Chooser::Chooser():
         data{ new Data } { }
 
@@ -33,6 +95,7 @@ namespace Choice
 
     void Chooser::choice_count(size_t n)
     {
+        data->layer.invalidate();
         data->choices.clear();
         data->choices.reserve(n);
         data->selection = {};
@@ -40,11 +103,13 @@ namespace Choice
 
     void Chooser::add_choice(std::string_view choice)
     {
+        data->layer.invalidate();
         data->choices.emplace_back(choice);
     }
 
     void Chooser::reason(std::string_view s)
     {
+        data->layer.invalidate();
         data->reason = s;
     }
 
@@ -62,6 +127,7 @@ namespace Choice
     {
         if (rep(data->selection) > 0)
         {
+            data->layer.invalidate();
             data->selection = retract(data->selection);
         }
     }
@@ -70,72 +136,43 @@ namespace Choice
     {
         if (rep(extend(data->selection)) < data->choices.size())
         {
+            data->layer.invalidate();
             data->selection = extend(data->selection);
         }
     }
 
     void Chooser::top()
     {
+        data->layer.invalidate();
         data->selection = {};
     }
 
     void Chooser::bottom()
     {
+        data->layer.invalidate();
         data->selection = Selection{ data->choices.size() - 1 };
     }
 
     void Chooser::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions& screen)
     {
-        // Setup a background so it is easier to see the choices.
-        constexpr Vec4f bg_color = Vec4f(0.f, 0.f, 0.f, 0.85f);
-        Render::draw_background(renderer, screen, bg_color);
-        auto font_ctx = atlas->render_font_context(Data::font_size);
-
-        // We don't want to transform any text at the top.
-        renderer->set_shader(Render::VertShader::OneOneTransform);
-        // Render the choice description at the top.
+        CPU_PROFILE_SCOPE("Chooser::render");
+        // The choices are only drawn again once the camera moves (or they change), which it stops doing soon after
+        // the selection does.
+        if (renderer->camera() != data->layer_camera)
         {
-            auto title_font_ctx = atlas->render_font_context(Data::title_font_size);
-            renderer->set_shader(Render::FragShader::Text);
-            Vec2f pos = Vec2f(10.f, rep(screen.height) - rep(Data::title_font_size) - 10.f);
-            constexpr Vec4f color = hex_to_vec4f(0xFFFFFFFF);
-            title_font_ctx.render_text(renderer, data->reason, pos, color);
-            title_font_ctx.flush(renderer);
+            data->layer.invalidate();
         }
-
-        // Similar to the editor, we want camera transforms.
-        renderer->set_shader(Render::VertShader::CameraTransform);
-
-        // Render the selection rect.
-        Vec2f selection_pos;
+        if (renderer->begin_cached_layer(&data->layer, screen))
         {
-            renderer->set_shader(Render::FragShader::BasicColor);
-            const auto& selection = data->choices[rep(data->selection)];
-            selection_pos = Vec2f(0.f, -(rep(data->selection) + Data::cursor_offset) * rep(Data::font_size));
-            auto size = font_ctx.measure_text(selection);
-            size.y = static_cast<float>(rep(Data::font_size));
-            constexpr auto color = hex_to_vec4f(0x7E8081AA);
-            renderer->solid_rect(selection_pos, size, color);
-            renderer->flush();
-        }
-
-        // Render entries.
-        float max_line_len = 0.0001f;
-        {
-            renderer->set_shader(Render::FragShader::Text);
-            Vec2f line_pos{};
-            for (auto& entry : data->choices)
-            {
-                constexpr auto color = hex_to_vec4f(0xFFFFFFFF);
-                auto pos = font_ctx.render_text(renderer, entry, line_pos, color);
-                line_pos.y -= static_cast<float>(rep(Data::font_size));
-                max_line_len = std::max(pos.x, max_line_len);
-            }
-            font_ctx.flush(renderer);
+            data->layer_camera = renderer->camera();
+            render_choices(data.get(), renderer, atlas, screen);
+            renderer->end_cached_layer(&data->layer);
         }
+        renderer->composite_cached_layer(data->layer);
 
         // Camera transform.
         {
+            float max_line_len = data->max_line_len;
             const float total_line_dist = static_cast<float>(data->choices.size()) * rep(Data::font_size);
             // We want the camera to zoom out as the user adds new lines otherwise lines earlier
             // may be harder to see.
@@ -147,7 +184,7 @@ namespace Choice
             float target_scale_x = zoom_factor_x / (max_line_len * 0.75f);
 
             auto camera = renderer->camera();
-            camera = Render::cursor_camera_transform(camera, selection_pos, target_scale_x, zoom_factor_x, renderer->delta_time());
+            camera = Render::cursor_camera_transform(camera, data->selection_pos, target_scale_x, zoom_factor_x, renderer->delta_time());
             renderer->camera(camera);
         }
     }
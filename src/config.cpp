@@ -219,6 +219,7 @@ namespace Config
             .multipass_crt = true,
             .crt_mode = false,
             .light_mode = false,
+            .blur_quality = 2, // Medium.
         };
 
         SystemColors system_colors_instance =
@@ -499,7 +500,8 @@ namespace Config
                             screen_warp,
                             multipass_crt,
                             crt_mode,
-                            light_mode);
+                            light_mode,
+                            blur_quality);
 
         constexpr std::string_view system_effects_path = "system.effects";
 
@@ -0,0 +1,151 @@
+#include "cpu-profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CPUProfiler
+{
+    namespace
+    {
+        // An event with 'end_ns == begin_ns' and no duration marks a frame.
+        struct Event
+        {
+            const char* name;
+            uint64_t begin_ns;
+            uint64_t end_ns;
+        };
+
+        // Roughly several seconds of a busy frame.
+        constexpr uint64_t ring_capacity = 1u << 16;
+
+        constexpr const char* frame_marker = "Frame";
+
+        struct ThreadRing
+        {
+            Event events[ring_capacity];
+            // Only the owning thread writes, the index is published so a dump sees whole events.
+            std::atomic<uint64_t> written{ 0 };
+            const char* name = nullptr;
+            int tid = 0;
+        };
+
+        // Rings outlive their threads so a dump still sees what they recorded.
+        std::mutex rings_lock;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+
+        ThreadRing* register_thread()
+        {
+            std::lock_guard lock{ rings_lock };
+            rings.push_back(std::make_unique<ThreadRing>());
+            ThreadRing* ring = rings.back().get();
+            ring->tid = static_cast<int>(rings.size());
+            return ring;
+        }
+
+        ThreadRing* thread_ring()
+        {
+            thread_local ThreadRing* ring = register_thread();
+            return ring;
+        }
+
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        void append_escaped(std::string* out, const char* text)
+        {
+            for (const char* c = text; *c != '\0'; ++c)
+            {
+                if (*c == '"' or *c == '\\')
+                {
+                    out->push_back('\\');
+                }
+                out->push_back(*c);
+            }
+        }
+
+        void append_separator(std::string* out, bool* first)
+        {
+            if (not *first)
+            {
+                out->append(",\n");
+            }
+            *first = false;
+        }
+
+        void append_thread_name(std::string* out, const ThreadRing& ring, bool* first)
+        {
+            append_separator(out, first);
+            out->append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"", ring.tid));
+            append_escaped(out, ring.name);
+            out->append("\"}}");
+        }
+
+        void append_event(std::string* out, const ThreadRing& ring, const Event& event, bool* first)
+        {
+            append_separator(out, first);
+            // Chrome traces count in microseconds.
+            const double ts = static_cast<double>(event.begin_ns) / 1000.0;
+            out->append("{\"name\":\"");
+            append_escaped(out, event.name);
+            if (event.name == frame_marker)
+            {
+                out->append(std::format("\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":1,\"tid\":{}}}", ts, ring.tid));
+                return;
+            }
+            const double dur = static_cast<double>(event.end_ns - event.begin_ns) / 1000.0;
+            out->append(std::format("\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}", ts, dur, ring.tid));
+        }
+    } // namespace [anon]
+
+    uint64_t now_ns()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    void name_thread(const char* name)
+    {
+        thread_ring()->name = name;
+    }
+
+    void mark_frame()
+    {
+        const uint64_t now = now_ns();
+        record_event(frame_marker, now, now);
+    }
+
+    void record_event(const char* name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        ThreadRing* ring = thread_ring();
+        const uint64_t index = ring->written.load(std::memory_order_relaxed);
+        ring->events[index % ring_capacity] = { .name = name, .begin_ns = begin_ns, .end_ns = end_ns };
+        ring->written.store(index + 1, std::memory_order_release);
+    }
+
+    Errno write_chrome_trace(std::string_view path)
+    {
+        std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        {
+            std::lock_guard lock{ rings_lock };
+            for (const auto& ring : rings)
+            {
+                if (ring->name != nullptr)
+                {
+                    append_thread_name(&out, *ring, &first);
+                }
+                const uint64_t written = ring->written.load(std::memory_order_acquire);
+                const uint64_t oldest = written > ring_capacity ? written - ring_capacity : 0;
+                for (uint64_t i = oldest; i != written; ++i)
+                {
+                    append_event(&out, *ring, ring->events[i % ring_capacity], &first);
+                }
+            }
+        }
+        out.append("\n]}\n");
+        return save_file(path, out);
+    }
+} // namespace CPUProfiler
\ No newline at end of file
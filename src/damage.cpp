@@ -0,0 +1,113 @@
+#include "damage.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace Damage
+{
+    namespace
+    {
+        // Edges are kept wide so that huge viewports (e.g. strips spanning any screen width) cannot overflow.
+        struct DamageBox
+        {
+            int64_t x0;
+            int64_t y0;
+            int64_t x1;
+            int64_t y1;
+        };
+
+        constexpr DamageBox box_for(const Render::RenderViewport& viewport)
+        {
+            const int64_t x = rep(viewport.offset_x);
+            const int64_t y = rep(viewport.offset_y);
+            return { .x0 = x, .y0 = y, .x1 = x + rep(viewport.width), .y1 = y + rep(viewport.height) };
+        }
+
+        constexpr bool empty_box(const DamageBox& box)
+        {
+            return box.x1 <= box.x0 or box.y1 <= box.y0;
+        }
+
+        std::mutex damage_lock;
+        bool damage_pending = false;
+        bool damage_all = false;
+        // The union of every box reported since the last 'take'.
+        DamageBox damage_bounds{};
+    } // namespace [anon]
+
+    void add(const Render::RenderViewport& viewport)
+    {
+        const DamageBox box = box_for(viewport);
+        if (empty_box(box))
+            return;
+        std::lock_guard lock{ damage_lock };
+        if (not damage_pending)
+        {
+            damage_bounds = box;
+            damage_pending = true;
+            return;
+        }
+        damage_bounds.x0 = std::min(damage_bounds.x0, box.x0);
+        damage_bounds.y0 = std::min(damage_bounds.y0, box.y0);
+        damage_bounds.x1 = std::max(damage_bounds.x1, box.x1);
+        damage_bounds.y1 = std::max(damage_bounds.y1, box.y1);
+    }
+
+    void add_all()
+    {
+        std::lock_guard lock{ damage_lock };
+        damage_pending = true;
+        damage_all = true;
+    }
+
+    bool pending()
+    {
+        std::lock_guard lock{ damage_lock };
+        return damage_pending;
+    }
+
+    FrameDamage take(const ScreenDimensions& screen)
+    {
+        std::lock_guard lock{ damage_lock };
+        FrameDamage damage;
+        const int64_t width = rep(screen.width);
+        const int64_t height = rep(screen.height);
+        if (damage_pending)
+        {
+            const DamageBox bounds = damage_all ? DamageBox{ .x0 = 0, .y0 = 0, .x1 = width, .y1 = height }
+                                                : DamageBox{ .x0 = std::max<int64_t>(damage_bounds.x0, 0),
+                                                             .y0 = std::max<int64_t>(damage_bounds.y0, 0),
+                                                             .x1 = std::min(damage_bounds.x1, width),
+                                                             .y1 = std::min(damage_bounds.y1, height) };
+            if (not empty_box(bounds))
+            {
+                damage.empty = false;
+                damage.full = bounds.x0 == 0 and bounds.y0 == 0 and bounds.x1 == width and bounds.y1 == height;
+                damage.region = { .offset_x = Render::ScissorOffsetX(bounds.x0),
+                                  .offset_y = Render::ScissorOffsetY(bounds.y0),
+                                  .width = Width(bounds.x1 - bounds.x0),
+                                  .height = Height(bounds.y1 - bounds.y0) };
+            }
+        }
+        damage_pending = false;
+        damage_all = false;
+        return damage;
+    }
+
+    bool intersects(const FrameDamage& damage, const Render::RenderViewport& viewport)
+    {
+        if (damage.empty)
+            return false;
+        if (damage.full)
+            return true;
+        const DamageBox box = box_for(viewport);
+        const int64_t x0 = rep(damage.region.offset_x);
+        const int64_t y0 = rep(damage.region.offset_y);
+        return box.x0 < x0 + rep(damage.region.width)
+            and x0 < box.x1
+            and box.y0 < y0 + rep(damage.region.height)
+            and y0 < box.y1;
+    }
+} // namespace Damage
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <string>
 
 #include "config.h"
+#include "cpu-profiler.h"
+#include "damage.h"
 #include "util.h"
 #include "vec.h"
 
@@ -12,6 +14,7 @@ namespace Examples
 {
     void Intro::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions& screen)
     {
+        CPU_PROFILE_SCOPE("Intro::render");
         constexpr auto font_size = Glyph::FontSize{ 32 };
         constexpr float quad_padding = 2.f;
         // The vertex shader will not change.
@@ -86,6 +89,7 @@ namespace Examples
             Vec2f size{ slice_x, rep(font_size) + 0.f };
             pos.x = padding;
             pos.y -= padding + rep(font_size);
+            const float row_y = pos.y;
             // HSV
             {
                 renderer->solid_rect(pos, size, hex_to_vec4f(0xFFFFFFFF));
@@ -115,6 +119,14 @@ namespace Examples
                 pos.y -= (size.y - font_ctx.current_font_line_height()) / 2.f;
                 font_ctx.render_text(renderer, txt, pos, Config::system_colors().default_font_color);
                 font_ctx.flush(renderer);
+
+                // The HSV rect follows 'time' and the strike rect and readout follow the ticks, so the whole row
+                // changes every frame.  Padding covers the readout, which sits a little off the row.
+                const float row_end = pos.x + font_ctx.measure_text(txt).x;
+                Damage::add({ .offset_x = Render::ViewportOffsetX{ 0 },
+                              .offset_y = Render::ViewportOffsetY{ static_cast<int>(row_y - padding) },
+                              .width = Width{ static_cast<int>(row_end + padding) },
+                              .height = Height{ static_cast<int>(size.y + padding * 2.f) } });
             }
         }
 
@@ -215,10 +227,11 @@ namespace Examples
             // Draw the track first.
             {
                 // This is a basic line which spans the middle of the viewport.
-                renderer->set_shader(Render::FragShader::BasicColor);
+                renderer->set_shader(Render::FragShader::Line);
                 Vec2f start{ in.track_x, in.midpoint };
                 Vec2f end = { in.track_x + in.track_length, in.midpoint };
                 renderer->line(start, end, DragNSnap::Data::track_thickness, hex_to_vec4f(0xCE9178FF));
+                renderer->flush();
             }
 
             // Draw ball.
@@ -268,10 +281,12 @@ namespace Examples
             drag_n_snap_begin_drag(data.get());
         }
         drag_n_snap_process_mouse_move_drag(data.get(), mouse_pos);
+        Damage::add(viewport);
     }
 
     void DragNSnap::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const Render::RenderViewport& viewport)
     {
+        CPU_PROFILE_SCOPE("DragNSnap::render");
         // This is a basic track with a ball on it.
         // ------*-----
         renderer->set_shader(Render::VertShader::OneOneTransform);
@@ -362,6 +377,11 @@ namespace Examples
         if (data->movment_offset_lerp != 0.f)
         {
             data->movment_offset_lerp = lerp(data->movment_offset_lerp, Vec2f(0.f), renderer->delta_time());
+            // Snap like 'ease_expon_val' does, otherwise this only reaches zero once the float underflows.
+            if (std::abs(data->movment_offset_lerp.x) < 0.005f)
+            {
+                data->movment_offset_lerp = 0.f;
+            }
         }
 
         if (data->movment_offset_linear != 0.f)
@@ -376,5 +396,15 @@ namespace Examples
                 data->movment_offset_linear = 0.f;
             }
         }
+
+        // Keep drawing while the balls move.  A drag ends in 'mouse_up', which has no viewport to report, so frames
+        // keep coming for as long as the drag lasts.
+        if (drag_n_snap_dragging(*data)
+            or data->movement_offset_exp != 0.f
+            or data->movment_offset_lerp != 0.f
+            or data->movment_offset_linear != 0.f)
+        {
+            Damage::add(viewport);
+        }
     }
 } // namespace Examples
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "feed.h"
 
+#include <limits>
 #include <string>
 #include <vector>
 
 #include <SDL2/SDL_timer.h>
 
 #include "config.h"
+#include "cpu-profiler.h"
+#include "damage.h"
 #include "enum-utils.h"
 #include "util.h"
 #include "vec.h"
@@ -43,6 +46,21 @@ namespace Feed
             new_color.a = lerp(data.color.a, 0.f, percent);
             return new_color;
         }
+
+        // Messages are stacked up from this offset in the bottom left corner.
+        constexpr float render_offset = 20.f;
+
+        // Everything the feed may draw over: a strip along the bottom of the screen, as wide as any screen.
+        void damage_feed(const Messages& messages)
+        {
+            const int font_size = Config::feed_state().feed_font_size;
+            // One more line leaves room for the backgrounds, which start a little below the text.
+            const int height = static_cast<int>(render_offset) + static_cast<int>(messages.size() + 1) * font_size;
+            Damage::add({ .offset_x = Render::ViewportOffsetX{ 0 },
+                          .offset_y = Render::ViewportOffsetY{ 0 },
+                          .width = Width{ std::numeric_limits<int>::max() },
+                          .height = Height{ height } });
+        }
     } // namespace [anon]
 
     struct MessageFeed::Data
@@ -62,6 +80,7 @@ namespace Feed
         data->messages.push_back({ .message = std::string{ message },
                                    .start = SDL_GetTicks(),
                                    .color = Config::feed_colors().info });
+        damage_feed(data->messages);
     }
 
     void MessageFeed::queue_error(std::string_view error)
@@ -71,6 +90,7 @@ namespace Feed
         data->messages.push_back({ .message = std::string{ error },
                                    .start = SDL_GetTicks(),
                                    .color = Config::feed_colors().error });
+        damage_feed(data->messages);
     }
 
     void MessageFeed::queue_warning(std::string_view warning)
@@ -80,10 +100,12 @@ namespace Feed
         data->messages.push_back({ .message = std::string{ warning },
                                    .start = SDL_GetTicks(),
                                    .color = Config::feed_colors().warning });
+        damage_feed(data->messages);
     }
 
     void MessageFeed::render_queue(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions&)
     {
+        CPU_PROFILE_SCOPE("MessageFeed::render_queue");
         // DO NOT reap() in the render loop!  This is performance-sensitive.
 
         // Set the appropriate vertex and fragment shaders.
@@ -100,8 +122,6 @@ namespace Feed
 
         const auto ticks = SDL_GetTicks();
 
-        constexpr float render_offset = 20.f;
-
         // Render each message.
         Vec2f pos = Vec2f(render_offset, render_offset);
 
@@ -138,6 +158,13 @@ namespace Feed
             pos.y += rep(font_size);
         }
         font_ctx.flush(renderer);
+
+        // Messages fade out, so keep drawing until the newest one is gone (which takes one more frame to clear).
+        if (not data->messages.empty()
+            and ticks <= data->messages.back().start + MessageData::message_lifetime)
+        {
+            damage_feed(data->messages);
+        }
     }
 
     void MessageFeed::reap()
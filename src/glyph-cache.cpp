@@ -2,12 +2,15 @@
 
 #include <algorithm>
 #include <format>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
 #include "config.h"
+#include "cpu-profiler.h"
 #include "enum-utils.h"
 #include "feed.h"
 #include "scoped-handle.h"
@@ -111,6 +114,14 @@ namespace Glyph
         using UnicodeGlyphMap = std::unordered_map<UTF8::Codepoint, UnicodeGlyphInfo>;
 
         using FallbackFontCache = std::vector<FTFaceHandle>;
+
+        // A lookup which could not be served from the snapshot (see 'Atlas::begin_snapshot').  'glyph' is the
+        // invalid codepoint when the font size itself was missing.
+        struct SnapshotMiss
+        {
+            int font_size;
+            UTF8::Codepoint glyph;
+        };
     } // namespace [anon]
 
     struct CachedFont
@@ -143,10 +154,23 @@ namespace Glyph
         CachedFontsMap cached_fonts;
 
         Render::GlyphTexture texture{};
+        // See 'Atlas::generation'.
+        uint64_t generation = 0;
+
+        // See 'Atlas::begin_snapshot'.
+        bool snapshot = false;
+        std::mutex snapshot_misses_lock;
+        std::vector<SnapshotMiss> snapshot_misses;
     };
 
     namespace
     {
+        void submit_atlas_glyph(Atlas::Data* data, const Render::GlyphEntry& entry)
+        {
+            ++data->generation;
+            Render::SceneRenderer::submit_glyph_data(data->texture, entry);
+        }
+
         FT_Face identify_font_face_for_glyph(Atlas::Data* data, UTF8::Codepoint glyph)
         {
             // Try the most obvious spot first, the font currently selected.
@@ -270,6 +294,7 @@ namespace Glyph
 
         bool rasterize_cached_glyph(Atlas::Data* data, CachedFont* font, UnicodeGlyphInfo* info, UTF8::Codepoint glyph)
         {
+            CPU_PROFILE_SCOPE("Rasterize glyph");
             // Do not attempt to rasterize an invalid codepoint (what would we do anyway?).
             if (glyph == UTF8::invalid_codepoint)
                 return false;
@@ -319,7 +344,7 @@ namespace Glyph
                 .height = Height(face->glyph->bitmap.rows),
                 .buffer = face->glyph->bitmap.buffer
             };
-            Render::SceneRenderer::submit_glyph_data(data->texture, entry);
+            submit_atlas_glyph(data, entry);
 
             // Fill in the info.
             info->rasterized = true;
@@ -328,12 +353,34 @@ namespace Glyph
 
         enum class Rasterize : bool { No, Yes };
 
+        void queue_snapshot_miss(Atlas::Data* data, int font_size, UTF8::Codepoint glyph)
+        {
+            std::lock_guard lock{ data->snapshot_misses_lock };
+            data->snapshot_misses.push_back({ .font_size = font_size, .glyph = glyph });
+        }
+
         UnicodeGlyphInfo* request_cached_glyph(Atlas::Data* data, CachedFont* font, UTF8::Codepoint glyph, Rasterize rasterize)
         {
             // Do not attempt to rasterize an invalid codepoint (what would we do anyway?).
             if (glyph == UTF8::invalid_codepoint)
                 return nullptr;
 
+            // The snapshot is read-only, anything it cannot serve waits for 'Atlas::end_snapshot'.
+            if (data->snapshot)
+            {
+                auto itr = font->cached_glyphs_map.find(glyph);
+                if (itr != font->cached_glyphs_map.end())
+                {
+                    auto* info = &itr->second;
+                    if (info->rasterized or not is_yes(rasterize))
+                        return info;
+                    if (info->failed_to_rasterize)
+                        return nullptr;
+                }
+                queue_snapshot_miss(data, font->font_size, glyph);
+                return nullptr;
+            }
+
             auto [itr, inserted] = font->cached_glyphs_map.emplace(glyph, UnicodeGlyphInfo{ });
             if (not inserted)
             {
@@ -554,7 +601,7 @@ namespace Glyph
                     .height = Height(face->glyph->bitmap.rows),
                     .buffer = face->glyph->bitmap.buffer
                 };
-                Render::SceneRenderer::submit_glyph_data(data->texture, entry);
+                submit_atlas_glyph(data, entry);
 
                 x += face->glyph->bitmap.width;
                 max_glyph_height_for_row = std::max(max_glyph_height_for_row, static_cast<int>(face->glyph->bitmap.rows));
@@ -604,7 +651,7 @@ namespace Glyph
                     .height = Height(face->glyph->bitmap.rows),
                     .buffer = face->glyph->bitmap.buffer
                 };
-                Render::SceneRenderer::submit_glyph_data(data->texture, entry);
+                submit_atlas_glyph(data, entry);
 
                 x += face->glyph->bitmap.width;
                 max_glyph_height_for_row = std::max(max_glyph_height_for_row, static_cast<int>(face->glyph->bitmap.rows));
@@ -738,7 +785,7 @@ namespace Glyph
                     .height = Height{ buf_h },
                     .buffer = arr
                 };
-                Render::SceneRenderer::submit_glyph_data(data->texture, entry);
+                submit_atlas_glyph(data.get(), entry);
             }
         }
 
@@ -767,6 +814,7 @@ namespace Glyph
                         const Vec2f& pos,
                         const Vec4f& color)
     {
+        atlas->select_primary_texture(renderer);
         Vec2f new_pos = pos;
         UTF8::CodepointWalker walker{ text };
         while (not walker.exhausted())
@@ -783,11 +831,11 @@ namespace Glyph
 
             auto* filtered_color = filter(&color, &colors);
 
-            renderer->render_image(Vec2f(x2, -y2),
-                                    Vec2f(w, -h),
-                                    Vec2f(info.tx, info.ty),
-                                    Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
-                                    *filtered_color);
+            renderer->ui_glyph(Vec2f(x2, -y2),
+                                Vec2f(w, -h),
+                                Vec2f(info.tx, info.ty),
+                                Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
+                                *filtered_color);
         }
         return new_pos;
     }
@@ -797,6 +845,7 @@ namespace Glyph
                         const Vec2f& pos,
                         const Vec4f& color)
     {
+        atlas->select_primary_texture(renderer);
         Vec2f new_pos = pos;
 
         const auto& [info, ax, filter] = extract_glyph_info(atlas->data.get(), font, tabs, cp, Rasterize::Yes, make_yes_no<RenderWhitespace>(render_ws));
@@ -810,11 +859,11 @@ namespace Glyph
 
         auto* filtered_color = filter(&color, &colors);
 
-        renderer->render_image(Vec2f(x2, -y2),
-                                Vec2f(w, -h),
-                                Vec2f(info.tx, info.ty),
-                                Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
-                                *filtered_color);
+        renderer->ui_glyph(Vec2f(x2, -y2),
+                            Vec2f(w, -h),
+                            Vec2f(info.tx, info.ty),
+                            Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
+                            *filtered_color);
 
         return new_pos;
     }
@@ -824,6 +873,7 @@ namespace Glyph
                     const Vec2f& pos,
                     const Vec4f& color)
     {
+        atlas->select_primary_texture(renderer);
         Vec2f new_pos = pos;
 
         const auto& [info, ax, filter] = extract_glyph_info(atlas->data.get(), font, tabs, cp, Rasterize::Yes, make_yes_no<RenderWhitespace>(render_ws));
@@ -837,11 +887,11 @@ namespace Glyph
 
         auto* filtered_color = filter(&color, &colors);
 
-        renderer->render_image(Vec2f(x2, -y2),
-                                Vec2f(w, -h),
-                                Vec2f(info.tx, info.ty),
-                                Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
-                                *filtered_color);
+        renderer->ui_glyph(Vec2f(x2, -y2),
+                            Vec2f(w, -h),
+                            Vec2f(info.tx, info.ty),
+                            Vec2f((w) / static_cast<float>(atlas->data->width), (h) / static_cast<float>(atlas->data->height)),
+                            *filtered_color);
 
         return new_pos;
     }
@@ -852,6 +902,7 @@ namespace Glyph
                         const Vec2f& pos,
                         const Vec4f& color)
     {
+        atlas->select_primary_texture(renderer);
         Vec2f new_pos = pos;
         UTF8::CodepointWalker walker{ text };
         while (not walker.exhausted())
@@ -868,18 +919,18 @@ namespace Glyph
 
             auto* filtered_color = filter(&color, &colors);
 
-            renderer->render_image(Vec2f(x2, -y2),
-                                    Vec2f(w, -h),
-                                    Vec2f(info.tx, info.ty),
-                                    Vec2f(info.bw / static_cast<float>(atlas->data->width), info.bh / static_cast<float>(atlas->data->height)),
-                                    *filtered_color);
+            renderer->ui_glyph(Vec2f(x2, -y2),
+                                Vec2f(w, -h),
+                                Vec2f(info.tx, info.ty),
+                                Vec2f(info.bw / static_cast<float>(atlas->data->width), info.bh / static_cast<float>(atlas->data->height)),
+                                *filtered_color);
         }
         return new_pos;
     }
 
     void RenderFontContext::flush(Render::SceneRenderer* renderer)
     {
-        atlas->bind_primary_texture();
+        atlas->select_primary_texture(renderer);
         renderer->flush();
     }
 
@@ -979,6 +1030,15 @@ namespace Glyph
 
     RenderFontContext Atlas::render_font_context(FontSize size)
     {
+        if (data->snapshot)
+        {
+            auto itr = data->cached_fonts.find(rep(size));
+            if (itr != data->cached_fonts.end())
+                return { this, &itr->second };
+            // Make do with the selected size until the next frame.
+            queue_snapshot_miss(data.get(), rep(size), UTF8::invalid_codepoint);
+            return { this, data->selected_font };
+        }
         try_set_font_size(data.get(), rep(size), standard_reporter);
         return { this, data->selected_font };
     }
@@ -987,4 +1047,37 @@ namespace Glyph
     {
         Render::SceneRenderer::bind_glyph_texture(data->texture);
     }
+
+    void Atlas::select_primary_texture(Render::SceneRenderer* renderer)
+    {
+        renderer->select_texture(data->texture);
+    }
+
+    uint64_t Atlas::generation() const
+    {
+        return data->generation;
+    }
+
+    void Atlas::begin_snapshot()
+    {
+        data->snapshot = true;
+    }
+
+    bool Atlas::end_snapshot()
+    {
+        data->snapshot = false;
+        const bool missed = not data->snapshot_misses.empty();
+        // Note: Every other thread is done with the atlas by now, so the queue needs no lock.
+        for (const SnapshotMiss& miss : data->snapshot_misses)
+        {
+            if (not try_set_font_size(data.get(), miss.font_size, standard_reporter))
+                continue;
+            if (miss.glyph != UTF8::invalid_codepoint)
+            {
+                request_cached_glyph(data.get(), data->selected_font, miss.glyph, Rasterize::Yes);
+            }
+        }
+        data->snapshot_misses.clear();
+        return missed;
+    }
 } // namespace Glyph
\ No newline at end of file
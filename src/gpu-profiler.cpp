@@ -0,0 +1,199 @@
+#include "gpu-profiler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace GPUProfiler
+{
+    namespace
+    {
+        constexpr int frames_in_flight = 2;
+
+        struct ScopeRecord
+        {
+            int timing;
+            GLuint begin_query;
+            GLuint end_query = 0;
+        };
+
+        // The queries issued during one frame.
+        struct FrameQueries
+        {
+            // Query objects are never deleted, only reused by later frames.
+            std::vector<GLuint> pool;
+            int used = 0;
+            std::vector<ScopeRecord> scopes;
+        };
+
+        struct ScopeHistory
+        {
+            float samples[average_window]{};
+            int next = 0;
+            float sum = 0.f;
+        };
+
+        bool profiling_enabled = false;
+        FrameQueries frame_queries[frames_in_flight];
+        int current_frame = 0;
+        int open_depth = 0;
+        std::vector<ScopeTiming> timings;
+        std::vector<ScopeHistory> histories;
+        // Per frame totals, indexed like 'timings'.  Negative for scopes not seen in the frame being resolved.
+        std::vector<double> frame_totals_ms;
+        int dropped = 0;
+
+        GLuint acquire_query(FrameQueries* frame)
+        {
+            if (frame->used == static_cast<int>(frame->pool.size()))
+            {
+                GLuint query;
+                glGenQueries(1, &query);
+                frame->pool.push_back(query);
+            }
+            return frame->pool[frame->used++];
+        }
+
+        int timing_index(std::string_view name)
+        {
+            for (int i = 0; i != static_cast<int>(timings.size()); ++i)
+            {
+                if (timings[i].name == name)
+                    return i;
+            }
+            timings.push_back({ .name = name, .depth = open_depth, .last_ms = 0.f, .average_ms = 0.f, .samples = 0 });
+            histories.push_back({ });
+            return static_cast<int>(timings.size()) - 1;
+        }
+
+        void add_sample(int index, float ms)
+        {
+            ScopeTiming& timing = timings[index];
+            ScopeHistory& history = histories[index];
+            history.sum += ms - history.samples[history.next];
+            history.samples[history.next] = ms;
+            history.next = (history.next + 1) % average_window;
+            timing.samples = std::min(timing.samples + 1, average_window);
+            timing.last_ms = ms;
+            timing.average_ms = history.sum / static_cast<float>(timing.samples);
+        }
+
+        void resolve_frame(FrameQueries* frame)
+        {
+            if (frame->scopes.empty())
+                return;
+            // Queries complete in order, so the last one issued tells us about all of them.
+            GLint available = 0;
+            glGetQueryObjectiv(frame->pool[frame->used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == 0)
+            {
+                ++dropped;
+                return;
+            }
+            frame_totals_ms.assign(timings.size(), -1.0);
+            for (const ScopeRecord& scope : frame->scopes)
+            {
+                // A scope which is still open when the frame ends is not measured.
+                if (scope.end_query == 0)
+                    continue;
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(scope.begin_query, GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(scope.end_query, GL_QUERY_RESULT, &end);
+                double& total = frame_totals_ms[scope.timing];
+                total = std::max(total, 0.0) + static_cast<double>(end - begin) / 1'000'000.0;
+            }
+            for (int i = 0; i != static_cast<int>(frame_totals_ms.size()); ++i)
+            {
+                if (frame_totals_ms[i] >= 0.0)
+                {
+                    add_sample(i, static_cast<float>(frame_totals_ms[i]));
+                }
+            }
+        }
+    } // namespace [anon]
+
+    void enable(bool b)
+    {
+        profiling_enabled = b;
+    }
+
+    bool enabled()
+    {
+        return profiling_enabled;
+    }
+
+    void reset()
+    {
+        // Pending queries refer to the old timings.
+        for (FrameQueries& frame : frame_queries)
+        {
+            frame.used = 0;
+            frame.scopes.clear();
+        }
+        timings.clear();
+        histories.clear();
+        dropped = 0;
+    }
+
+    void end_frame()
+    {
+        // The oldest frame's queries have had the longest to finish; read them and hand the pool to the next
+        // frame.
+        current_frame = (current_frame + 1) % frames_in_flight;
+        FrameQueries& frame = frame_queries[current_frame];
+        resolve_frame(&frame);
+        frame.used = 0;
+        frame.scopes.clear();
+    }
+
+    std::span<const ScopeTiming> scope_timings()
+    {
+        return timings;
+    }
+
+    const ScopeTiming* find_scope_timing(std::string_view name)
+    {
+        for (const ScopeTiming& timing : timings)
+        {
+            if (timing.name == name)
+                return &timing;
+        }
+        return nullptr;
+    }
+
+    int dropped_frames()
+    {
+        return dropped;
+    }
+
+    Scope::Scope(std::string_view name):
+        frame_index{ current_frame }, record{ -1 }
+    {
+        if (not profiling_enabled)
+            return;
+        FrameQueries* frame = &frame_queries[current_frame];
+        const int timing = timing_index(name);
+        const GLuint query = acquire_query(frame);
+        glQueryCounter(query, GL_TIMESTAMP);
+        record = static_cast<int>(frame->scopes.size());
+        frame->scopes.push_back({ .timing = timing, .begin_query = query });
+        ++open_depth;
+    }
+
+    Scope::~Scope()
+    {
+        if (record == -1)
+            return;
+        --open_depth;
+        FrameQueries* frame = &frame_queries[current_frame];
+        // The frame (or the timings) moved on while the scope was open.
+        if (frame_index != current_frame
+            or record >= static_cast<int>(frame->scopes.size()))
+            return;
+        const GLuint query = acquire_query(frame);
+        glQueryCounter(query, GL_TIMESTAMP);
+        frame->scopes[record].end_query = query;
+    }
+} // namespace GPUProfiler
\ No newline at end of file
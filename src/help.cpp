@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "config.h"
+#include "cpu-profiler.h"
 #include "enum-utils.h"
 
 namespace Help
@@ -19,8 +20,11 @@ namespace Help
         constexpr HelpEntry commands[]
         {
             { .cmd = "F1 ",      .desc = " Show help" },
+            { .cmd = "F3 ",      .desc = " Write CPU trace" },
+            { .cmd = "F4 ",      .desc = " Toggle show GPU timings" },
             { .cmd = "F5 ",      .desc = " Toggle show FPS" },
             { .cmd = "F6 ",      .desc = " Reload shaders" },
+            { .cmd = "F7 ",      .desc = " Toggle show renderer stats" },
             { .cmd = "F9 ",      .desc = " Reload config (+CTRL to open config)" },
             { .cmd = "ESC ",     .desc = " Cancel command" },
         };
@@ -62,6 +66,8 @@ namespace Help
     {
         HelpTable commands_table_meta = compute_help_table(commands);
         HelpTable shortcuts_table_meta = compute_help_table(shortcuts);
+        // Everything but the blurred background, which changes underneath.
+        Render::CachedLayer layer;
 
         static constexpr auto font_size = Glyph::FontSize{ 18 };
         static constexpr float outline_thickness = 2.f;
@@ -96,6 +102,113 @@ namespace Help
 
             return { .box = bounding_box, .column_1 = first_pos, .column_2 = second_pos };
         }
+
+        void render_tables(Help::Data* data, Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions& screen)
+        {
+            const auto& colors = Config::system_colors();
+
+            // Setup a background so it is easier to see the help.
+            Vec4f bg_color = colors.background;
+            bg_color.a = 0.6f;
+            Render::draw_background(renderer, screen, bg_color);
+            auto font_ctx = atlas->render_font_context(Help::Data::font_size);
+
+            // To layout everything properly, we first need to compute the size of all the text tables.
+            renderer->set_shader(Render::VertShader::OneOneTransform);
+
+            auto [commands_box, commands_col1, commands_col2] = bounding_box_for(data->commands_table_meta, commands, &font_ctx);
+            auto [sc_box, sc_col1, sc_col2] = bounding_box_for(data->shortcuts_table_meta, shortcuts, &font_ctx);
+
+            Vec2f all_containers{ commands_box.x + sc_box.x, std::max(commands_box.y, sc_box.y) };
+            // Add some padding.
+            constexpr float padding = rep(Help::Data::font_size) / 8.f;
+            all_containers.x += padding;
+
+            // Mount to the center.
+            Vec2f box_pos;
+            box_pos.x = ((rep(screen.width) - all_containers.x) / 2.f);
+            box_pos.y = ((rep(screen.height) + all_containers.y) / 2.f);
+
+            Vec2f pos = box_pos;
+            renderer->set_shader(Render::FragShader::Text);
+            const Vec4f color = colors.default_font_color;
+            // Commands.
+            // Render "Commands" in center.
+            auto title_pos = pos;
+            title_pos.x += (commands_box.x - font_ctx.measure_text("Commands").x) / 2.f;
+            font_ctx.render_text(renderer, "Commands", title_pos, color);
+            pos.y -= rep(Help::Data::font_size);
+
+            for (auto& cmd : commands)
+            {
+                font_ctx.render_text(renderer, cmd.cmd, pos, color);
+                pos.x = box_pos.x + commands_col1.x;
+                font_ctx.render_text(renderer, cmd.desc, pos, color);
+                pos.y -= rep(Help::Data::font_size);
+                pos.x = box_pos.x;
+            }
+
+            // Now the shortcuts.
+            pos = box_pos;
+            const float box_offset = commands_box.x + padding;
+            pos.x += box_offset;
+
+            // Render "Shortcuts" in center.
+            title_pos = pos;
+            title_pos.x += (sc_box.x - font_ctx.measure_text("Shortcuts").x) / 2.f;
+            font_ctx.render_text(renderer, "Shortcuts", title_pos, color);
+            pos.y -= rep(Help::Data::font_size);
+
+            for (auto& sc : shortcuts)
+            {
+                font_ctx.render_text(renderer, sc.cmd, pos, color);
+                pos.x = box_pos.x + box_offset + sc_col1.x;
+                font_ctx.render_text(renderer, sc.desc, pos, color);
+                pos.y -= rep(Help::Data::font_size);
+                pos.x = box_pos.x + box_offset;
+            }
+            font_ctx.flush(renderer);
+
+            // Now we can put a small box around each one.
+            // Commands box.
+            pos = box_pos;
+            pos.x -= padding;
+            pos.y -= rep(Help::Data::font_size) * std::size(commands);
+            auto size = commands_box + padding;
+            pos.y -= padding * 2.f;
+            renderer->set_shader(Render::FragShader::BasicColor);
+            renderer->strike_rect(pos, size, Help::Data::outline_thickness, color);
+
+            // The separators.
+            // Commands separator.
+            pos = box_pos;
+            pos.x = box_pos.x + commands_col1.x;
+            pos.y -= rep(Help::Data::font_size) * std::size(commands);
+            pos.y -= padding * 2.f;
+            size = commands_box + padding;
+            size.x = Help::Data::outline_thickness;
+            renderer->solid_rect(pos, size, color);
+
+            // Shortcuts separator.
+            pos = box_pos;
+            pos.x = box_pos.x + box_offset + sc_col1.x;
+            pos.y -= rep(Help::Data::font_size) * std::size(shortcuts);
+            pos.y -= padding * 2.f;
+            size = sc_box + padding;
+            size.x = Help::Data::outline_thickness;
+            renderer->solid_rect(pos, size, color);
+
+            // Shortcuts box.
+            pos = box_pos;
+            pos.x += box_offset;
+            pos.x -= padding;
+            pos.y -= rep(Help::Data::font_size) * std::size(shortcuts);
+            size = sc_box + padding;
+            pos.y -= padding * 2.f;
+            renderer->strike_rect(pos, size, Help::Data::outline_thickness, color);
+
+            renderer->flush();
+        }
     } // namespace [anon]
 
     Help::Help():
@@ -105,121 +218,27 @@ namespace Help
 
     void Help::render(Render::SceneRenderer* renderer, Glyph::Atlas* atlas, const ScreenDimensions& screen)
     {
+        CPU_PROFILE_SCOPE("Help::render");
         // Blur the background for some flare.
         {
             // The background is already rendered to the default framebuffer, so we can just take that,
             // blur it, and render it back to the default framebuffer.
             renderer->set_shader(Render::VertShader::NoTransform);
+            const int quality = std::clamp(Config::system_effects().blur_quality, 0, count_of<Render::Effects::BlurQuality> - 1);
             Render::Effects::blur_background({ .src = Render::Framebuffer::Default, .dest = Render::Framebuffer::Default },
                                                 renderer,
-                                                Render::RenderViewport::basic(screen),
-                                                screen);
+                                                screen,
+                                                static_cast<Render::Effects::BlurQuality>(quality));
             // Default the blending mode.
             renderer->apply_blending_mode(Render::BlendingMode::Default);
         }
 
-        const auto& colors = Config::system_colors();
-
-        // Setup a background so it is easier to see the help.
-        Vec4f bg_color = colors.background;
-        bg_color.a = 0.6f;
-        Render::draw_background(renderer, screen, bg_color);
-        auto font_ctx = atlas->render_font_context(Data::font_size);
-
-        // To layout everything properly, we first need to compute the size of all the text tables.
-        renderer->set_shader(Render::VertShader::OneOneTransform);
-
-        auto [commands_box, commands_col1, commands_col2] = bounding_box_for(data->commands_table_meta, commands, &font_ctx);
-        auto [sc_box, sc_col1, sc_col2] = bounding_box_for(data->shortcuts_table_meta, shortcuts, &font_ctx);
-
-        Vec2f all_containers{ commands_box.x + sc_box.x, std::max(commands_box.y, sc_box.y) };
-        // Add some padding.
-        constexpr float padding = rep(Data::font_size) / 8.f;
-        all_containers.x += padding;
-
-        // Mount to the center.
-        Vec2f box_pos;
-        box_pos.x = ((rep(screen.width) - all_containers.x) / 2.f);
-        box_pos.y = ((rep(screen.height) + all_containers.y) / 2.f);
-
-        Vec2f pos = box_pos;
-        renderer->set_shader(Render::FragShader::Text);
-        const Vec4f color = colors.default_font_color;
-        // Commands.
-        // Render "Commands" in center.
-        auto title_pos = pos;
-        title_pos.x += (commands_box.x - font_ctx.measure_text("Commands").x) / 2.f;
-        font_ctx.render_text(renderer, "Commands", title_pos, color);
-        pos.y -= rep(Data::font_size);
-
-        for (auto& cmd : commands)
+        // The tables only change with the theme, so they are drawn once and composited after that.
+        if (renderer->begin_cached_layer(&data->layer, screen))
         {
-            font_ctx.render_text(renderer, cmd.cmd, pos, color);
-            pos.x = box_pos.x + commands_col1.x;
-            font_ctx.render_text(renderer, cmd.desc, pos, color);
-            pos.y -= rep(Data::font_size);
-            pos.x = box_pos.x;
-        }
-
-        // Now the shortcuts.
-        pos = box_pos;
-        const float box_offset = commands_box.x + padding;
-        pos.x += box_offset;
-
-        // Render "Shortcuts" in center.
-        title_pos = pos;
-        title_pos.x += (sc_box.x - font_ctx.measure_text("Shortcuts").x) / 2.f;
-        font_ctx.render_text(renderer, "Shortcuts", title_pos, color);
-        pos.y -= rep(Data::font_size);
-
-        for (auto& sc : shortcuts)
-        {
-            font_ctx.render_text(renderer, sc.cmd, pos, color);
-            pos.x = box_pos.x + box_offset + sc_col1.x;
-            font_ctx.render_text(renderer, sc.desc, pos, color);
-            pos.y -= rep(Data::font_size);
-            pos.x = box_pos.x + box_offset;
+            render_tables(data.get(), renderer, atlas, screen);
+            renderer->end_cached_layer(&data->layer);
         }
-        font_ctx.flush(renderer);
-
-        // Now we can put a small box around each one.
-        // Commands box.
-        pos = box_pos;
-        pos.x -= padding;
-        pos.y -= rep(Data::font_size) * std::size(commands);
-        auto size = commands_box + padding;
-        pos.y -= padding * 2.f;
-        renderer->set_shader(Render::FragShader::BasicColor);
-        renderer->strike_rect(pos, size, Data::outline_thickness, color);
-
-        // The separators.
-        // Commands separator.
-        pos = box_pos;
-        pos.x = box_pos.x + commands_col1.x;
-        pos.y -= rep(Data::font_size) * std::size(commands);
-        pos.y -= padding * 2.f;
-        size = commands_box + padding;
-        size.x = Data::outline_thickness;
-        renderer->solid_rect(pos, size, color);
-
-        // Shortcuts separator.
-        pos = box_pos;
-        pos.x = box_pos.x + box_offset + sc_col1.x;
-        pos.y -= rep(Data::font_size) * std::size(shortcuts);
-        pos.y -= padding * 2.f;
-        size = sc_box + padding;
-        size.x = Data::outline_thickness;
-        renderer->solid_rect(pos, size, color);
-
-        // Shortcuts box.
-        pos = box_pos;
-        pos.x += box_offset;
-        pos.x -= padding;
-        pos.y -= rep(Data::font_size) * std::size(shortcuts);
-        size = sc_box + padding;
-        pos.y -= padding * 2.f;
-        renderer->strike_rect(pos, size, Data::outline_thickness, color);
-
-        renderer->flush();
+        renderer->composite_cached_layer(data->layer);
     }
 } // namespace Help
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <cassert>
 
+#include <charconv>
 #include <format>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
@@ -12,16 +15,21 @@
 #include "choice.h"
 #include "config.h"
 #include "constants.h"
+#include "cpu-profiler.h"
+#include "damage.h"
 #include "examples.h"
 #include "feed.h"
 #include "glyph-cache.h"
+#include "gpu-profiler.h"
 #include "help.h"
+#include "render-graph.h"
 #include "renderer.h"
 #include "types.h"
 #include "ui-common.h"
 #include "util.h"
 #include "vec.h"
 #include "window-theming.h"
+#include "worker-pool.h"
 
 using namespace UI;
 
@@ -101,58 +109,57 @@ namespace
 
     void apply_multipass_postprocessing_crt(Render::SceneRenderer* renderer, const ScreenDimensions& screen, const Config::SystemEffects& system_effects)
     {
-        // We're going to start a multi-pass shader.
-        // Take the texture at FB0 and linearize it.
-        renderer->bind_framebuffer(Render::Framebuffer::Scratch1);
-        renderer->set_shader(Render::FragShader::CRTEasymodeLinearize);
-        renderer->render_framebuffer(screen, Render::Framebuffer::Default);
-
-        // Blur-horiz
-        renderer->bind_framebuffer(Render::Framebuffer::Scratch2);
-        renderer->custom_float_value1(0.25f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(4.0); // TAPS.
-        renderer->set_shader(Render::FragShader::CRTEasymodeBlurHoriz);
-        renderer->render_framebuffer(screen, Render::Framebuffer::Scratch1);
-
-        // Blur-vert.
-        renderer->bind_framebuffer(Render::Framebuffer::Scratch1);
-        renderer->custom_float_value1(0.25f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(4.0); // TAPS.
-        renderer->set_shader(Render::FragShader::CRTEasymodeBlurVert);
-        renderer->render_framebuffer(screen, Render::Framebuffer::Scratch2);
-
-        // Threshold.
+        using Render::FragShader;
+        using Render::TargetScale;
+        Render::RenderGraph graph;
+        const Render::GraphTarget frame = graph.import_framebuffer(Render::Framebuffer::Default);
+        const Render::GraphTarget window = graph.import_window();
+        // The halation only picks up the blurred glow, so everything before it runs at half resolution.
+        const Render::GraphTarget linear = graph.create_target(TargetScale::Half);
+        const Render::GraphTarget blur_horiz = graph.create_target(TargetScale::Half);
+        const Render::GraphTarget blur_vert = graph.create_target(TargetScale::Half);
+        const Render::GraphTarget thresh = graph.create_target(TargetScale::Half);
+        // If screen warping is enabled, the halation goes through one more pass on the way to the window.
+        const Render::GraphTarget halation = system_effects.screen_warp ? graph.create_target() : window;
+
+        graph.add_pass({ .name = "CRT linearize",
+                            .shader = FragShader::CRTEasymodeLinearize,
+                            .input = frame,
+                            .output = linear });
+        graph.add_pass({ .name = "CRT blur horizontal",
+                            .shader = FragShader::CRTEasymodeBlurHoriz,
+                            .input = linear,
+                            .output = blur_horiz,
+                            .custom_float_value1 = 0.25f, // GLOW_FALLOFF.
+                            .custom_float_value2 = 4.f }); // TAPS.
+        graph.add_pass({ .name = "CRT blur vertical",
+                            .shader = FragShader::CRTEasymodeBlurVert,
+                            .input = blur_horiz,
+                            .output = blur_vert,
+                            .custom_float_value1 = 0.25f, // GLOW_FALLOFF.
+                            .custom_float_value2 = 4.f }); // TAPS.
         // This shader needs access to the original input texture for diffing.
-        renderer->bind_framebuffer(Render::Framebuffer::Scratch2);
-        renderer->enable_prev_pass_texture(Render::Framebuffer::Default);
-        renderer->set_shader(Render::FragShader::CRTEasymodeThresh);
-        renderer->render_framebuffer(screen, Render::Framebuffer::Scratch1);
-
-        // Halation.
+        graph.add_pass({ .name = "CRT threshold",
+                            .shader = FragShader::CRTEasymodeThresh,
+                            .input = blur_vert,
+                            .output = thresh,
+                            .previous = frame });
         // This shader needs access to the original input texture for blending.
-        renderer->bind_framebuffer(Render::Framebuffer::Scratch1);
-        renderer->enable_prev_pass_texture(Render::Framebuffer::Default);
-        renderer->set_shader(Render::FragShader::CRTEasymodeHalation);
-        renderer->render_framebuffer(screen, Render::Framebuffer::Scratch2);
-
-        // Finally, unbind and set the shader back to regular image.
-        // If screen warping is enabled, we're going to reuse FB0 to render the warp and finally render that.
+        graph.add_pass({ .name = "CRT halation",
+                            .shader = FragShader::CRTEasymodeHalation,
+                            .input = thresh,
+                            .output = halation,
+                            .previous = frame });
         if (system_effects.screen_warp)
         {
-            renderer->bind_framebuffer(Render::Framebuffer::Default);
-            renderer->set_shader(Render::FragShader::CRTWarp);
-            renderer->render_framebuffer(screen, Render::Framebuffer::Scratch1);
-
-            renderer->unbind_framebuffer();
-            renderer->set_shader(Render::FragShader::Image);
-            renderer->render_framebuffer(screen, Render::Framebuffer::Default);
-        }
-        else
-        {
-            renderer->unbind_framebuffer();
-            renderer->set_shader(Render::FragShader::Image);
-            renderer->render_framebuffer(screen, Render::Framebuffer::Scratch1);
+            graph.add_pass({ .name = "CRT warp",
+                                .shader = FragShader::CRTWarp,
+                                .input = halation,
+                                .output = window });
         }
+        graph.execute(renderer, screen);
+        // Finally, set the shader back to regular image.
+        renderer->set_shader(FragShader::Image);
     }
 
     void apply_postprocessing_crt(Render::SceneRenderer* renderer, const ScreenDimensions& screen, const Config::SystemEffects& system_effects)
@@ -165,19 +172,24 @@ namespace
 
         if (system_effects.screen_warp)
         {
-            // We're going to swap to a new frame buffer so we can add a second pass to
-            // warp it.
-            renderer->bind_framebuffer(Render::Framebuffer::Scratch1);
-            renderer->set_shader(Render::FragShader::CRTEasymode);
-            renderer->render_framebuffer(screen, Render::Framebuffer::Default);
-
-            // Now warp it and render it to the default render buffer.
-            renderer->unbind_framebuffer();
-            renderer->set_shader(Render::FragShader::CRTWarp);
-            renderer->render_framebuffer(screen, Render::Framebuffer::Scratch1);
+            // The effect goes into a target of its own so that a second pass can warp it on the way to the window.
+            Render::RenderGraph graph;
+            const Render::GraphTarget easymode = graph.create_target();
+            graph.add_pass({ .name = "CRT easymode",
+                                .shader = Render::FragShader::CRTEasymode,
+                                .input = graph.import_framebuffer(Render::Framebuffer::Default),
+                                .output = easymode });
+            graph.add_pass({ .name = "CRT warp",
+                                .shader = Render::FragShader::CRTWarp,
+                                .input = easymode,
+                                .output = graph.import_window() });
+            graph.execute(renderer, screen);
+            // Finally, set the shader back to regular image.
+            renderer->set_shader(Render::FragShader::Image);
         }
         else
         {
+            GPUProfiler::Scope gpu_scope{ "CRT easymode" };
             renderer->set_shader(Render::FragShader::CRTEasymode);
             renderer->render_framebuffer(screen, Render::Framebuffer::Default);
         }
@@ -185,6 +197,7 @@ namespace
 
     void apply_framebuffer(Render::SceneRenderer* renderer, const ScreenDimensions& screen, const Config::SystemEffects& system_effects)
     {
+        GPUProfiler::Scope gpu_scope{ "Present" };
         renderer->unbind_framebuffer();
         renderer->set_shader(Render::VertShader::NoTransform);
         if (system_effects.postprocessing_enabled and system_effects.crt_mode)
@@ -256,25 +269,134 @@ namespace
         // I don't really care about freeing these...
         SDL_Cursor* cursors[count_of<CursorStyle>];
     };
+
+    struct LaunchOptions
+    {
+        // '--cpu-trace <path>' writes a CPU trace to 'path' on exit.
+        std::string_view cpu_trace_path;
+        // '--headless WxH --frames N' renders N frames offscreen then exits.
+        bool headless = false;
+        ScreenDimensions headless_screen = Constants::screen;
+        int headless_frames = 0;
+        // '--no-program-cache' builds every shader program from source, as on a first run.
+        bool program_cache = true;
+        // '--no-parallel-compile' builds programs when first used even if the driver can build them in the background.
+        bool parallel_compile = true;
+        // '--eager-programs' builds every shader program before the first frame, as startup used to.
+        bool eager_programs = false;
+    };
+
+    bool parse_int(std::string_view text, int* out)
+    {
+        const char* last = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), last, *out);
+        return ec == std::errc{} and ptr == last and *out > 0;
+    }
+
+    bool parse_dimensions(std::string_view text, ScreenDimensions* out)
+    {
+        const auto x = text.find('x');
+        if (x == std::string_view::npos)
+            return false;
+        int w;
+        int h;
+        if (not parse_int(text.substr(0, x), &w) or not parse_int(text.substr(x + 1), &h))
+            return false;
+        *out = { Width{ w }, Height{ h } };
+        return true;
+    }
+
+    bool parse_launch_options(int argc, char** argv, LaunchOptions* options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--cpu-trace" and has_value)
+            {
+                options->cpu_trace_path = argv[++i];
+            }
+            else if (arg == "--headless" and has_value)
+            {
+                options->headless = true;
+                if (not parse_dimensions(argv[++i], &options->headless_screen))
+                {
+                    fprintf(stderr, "ERROR: Expected '--headless WxH', got '%s'\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (arg == "--no-program-cache")
+            {
+                options->program_cache = false;
+            }
+            else if (arg == "--no-parallel-compile")
+            {
+                options->parallel_compile = false;
+            }
+            else if (arg == "--eager-programs")
+            {
+                options->eager_programs = true;
+            }
+            else if (arg == "--frames" and has_value)
+            {
+                if (not parse_int(argv[++i], &options->headless_frames))
+                {
+                    fprintf(stderr, "ERROR: Expected '--frames N', got '%s'\n", argv[i]);
+                    return false;
+                }
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unknown argument '%s'\n", argv[i]);
+                return false;
+            }
+        }
+
+        if (options->headless and options->headless_frames == 0)
+        {
+            fprintf(stderr, "ERROR: '--headless' requires '--frames N'\n");
+            return false;
+        }
+        return true;
+    }
 } // namespace [anon]
 
 int main(int argc, char** argv)
 {
-    (void)argc,argv;
+    CPU_PROFILE_THREAD("Main");
+    // Startup is reported once the first frame is done, since shader programs are built as that frame needs them.
+    const uint64_t startup_ns = CPUProfiler::now_ns();
+    bool startup_reported = false;
+    // Headless mode decides how the window is built, so argv is processed first.
+    LaunchOptions options;
+    if (not parse_launch_options(argc, argv, &options))
+        return 1;
+
     // This needs to be done before we build the primary render window.
     setup_platform_dpi();
 
+#ifndef _WIN32
+    // Without a display, SDL's offscreen driver gives us a surfaceless EGL context (e.g. Mesa llvmpipe).
+    if (options.headless)
+    {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+#endif // _WIN32
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
         fprintf(stderr, "ERROR: Could not initialize SDL: %s\n", SDL_GetError());
         return 1;
     }
 
+    const ScreenDimensions initial_screen = options.headless ? options.headless_screen : Constants::screen;
+    const Uint32 window_flags = options.headless ? SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL
+                                                 : SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
     SDL_Window *window =
         SDL_CreateWindow("basic-ui-template",
                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                         rep(Constants::screen.width), rep(Constants::screen.height),
-                         SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL);
+                         rep(initial_screen.width), rep(initial_screen.height),
+                         window_flags);
 
     if (window == nullptr)
     {
@@ -326,6 +448,10 @@ int main(int argc, char** argv)
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     Render::SceneRenderer renderer;
+    // Panels recorded on the worker pool each get a renderer of their own.
+    Render::SceneRenderer panel_renderer;
+    Render::SceneRenderer feed_renderer;
+    Render::SceneRenderer* const frame_renderers[] = { &renderer, &panel_renderer, &feed_renderer };
     Glyph::Atlas atlas;
     Feed::MessageFeed message_feed;
     Help::Help help;
@@ -395,12 +521,27 @@ int main(int argc, char** argv)
     if (not atlas.init(Config::system_fonts().current_font))
         return 1;
 
-    if (not Render::SceneRenderer::init(screen))
+    const std::string program_cache_dir = options.program_cache ? default_program_cache_directory() : std::string{ };
+    if (not Render::SceneRenderer::init(screen, Render::VertexLayout::Compact, program_cache_dir, options.parallel_compile))
         return 1;
+    if (options.eager_programs)
+    {
+        Render::SceneRenderer::build_all_programs();
+    }
 
-    // Populate initial resolutions.
-    renderer.resolution(Vec2f(static_cast<float>(rep(Constants::screen.width)),
-                                static_cast<float>(rep(Constants::screen.height))));
+    for (Render::SceneRenderer* frame_renderer : frame_renderers)
+    {
+        // Rects, images, and glyphs are all quads, so let the vertex shader expand them.
+        frame_renderer->quad_submission(Render::QuadSubmission::Instanced);
+
+        // Populate initial resolutions.
+        frame_renderer->resolution(Vec2f(static_cast<float>(rep(screen.width)),
+                                        static_cast<float>(rep(screen.height))));
+    }
+
+    // Note: This is declared after everything the jobs touch so the threads are joined first.
+    Workers::WorkerPool workers;
+    workers.init(Workers::default_worker_count());
 
     // Now we can populate the atlas since the renderer set up the graphics context.
     if (not atlas.populate_atlas())
@@ -427,6 +568,10 @@ int main(int argc, char** argv)
     Uint32 last_update = 0;
     Uint32 last_fps_update = 0;
     std::string fps_text;
+    Uint32 last_gpu_timings_update = 0;
+    std::vector<std::string> gpu_timing_lines;
+    Uint32 last_render_stats_update = 0;
+    std::vector<std::string> render_stats_lines;
     Config::SystemEffects system_effects_state = Config::system_effects();
     CommandMode cmd_mode = CommandMode::None;
     bool quit = false;
@@ -475,14 +620,21 @@ int main()
         scroll_window.title("Scrollbar Example");
     }
 
-    // At this point we can process argv.
+    // Headless runs count their frames so they can report a per-frame time.
+    int headless_frames_rendered = 0;
+    const uint64_t headless_start_ns = CPUProfiler::now_ns();
+
+    // Nothing has been drawn yet.
+    Damage::add_all();
 
     while (not quit)
     {
+        CPU_PROFILE_FRAME();
         SDL_Event e{ 0 };
 
         while (SDL_PollEvent(&e))
         {
+            CPU_PROFILE_SCOPE("Process event");
             switch (e.type)
             {
             case SDL_QUIT:
@@ -507,9 +659,14 @@ int main()
 
                             screen = { Width{ w }, Height{ h } };
                             glViewport(0, 0, w, h);
+                            // Resizing the framebuffers loses their contents.
+                            Damage::add_all();
 
                             // Update the renderers.
-                            renderer.resolution(Vec2f(static_cast<float>(w), static_cast<float>(h)));
+                            for (Render::SceneRenderer* frame_renderer : frame_renderers)
+                            {
+                                frame_renderer->resolution(Vec2f(static_cast<float>(w), static_cast<float>(h)));
+                            }
                             Render::SceneRenderer::screen_resize(screen);
 
                             // Update Drag'n Snap viewport.
@@ -523,6 +680,11 @@ int main()
                         break;
                     case SDL_WINDOWEVENT_SHOWN:
                         ui_state.special = remove_flag(ui_state.special, SpecialModes::SuspendRendering);
+                        Damage::add_all();
+                        break;
+                    case SDL_WINDOWEVENT_EXPOSED:
+                        // The window needs to be presented again, even if nothing in it changed.
+                        Damage::add_all();
                         break;
                     case SDL_WINDOWEVENT_MINIMIZED:
                         ui_state.special |= SpecialModes::SuspendRendering;
@@ -532,6 +694,7 @@ int main()
                         break;
                     case SDL_WINDOWEVENT_FOCUS_GAINED:
                         ui_state.special = remove_flag(ui_state.special, SpecialModes::SuspendRendering);
+                        Damage::add_all();
                         break;
                     }
                 }
@@ -586,6 +749,7 @@ int main()
                         {
                             message_feed.queue_info("Close window.");
                             scroll_window_closed = true;
+                            Damage::add(scroll_window_viewport);
                         }
                     }
                 }
@@ -663,11 +827,13 @@ int main()
                         break;
                     case SDLK_ESCAPE:
                         cmd_mode = CommandMode::None;
+                        Damage::add_all();
                         break;
                     case SDLK_F11:
                         if (implies(ui_state.mods, KeyMods::Ctrl))
                         {
                             ui_state.special = toggle(ui_state.special, SpecialModes::ShowGlyphs);
+                            Damage::add_all();
                         }
                         break;
                     case SDLK_F9:
@@ -687,6 +853,9 @@ int main()
                                 }
 
                                 message_feed.queue_info("Config reloaded.");
+                                // Cached overlays were drawn with the old theme.
+                                Render::CachedLayer::invalidate_all();
+                                Damage::add_all();
                             }
                         }
                         break;
@@ -694,9 +863,34 @@ int main()
                         message_feed.queue_info("Reloading shaders...");
                         Render::SceneRenderer::reload_shaders(asset_path, &message_feed);
                         break;
+                    case SDLK_F7:
+                        message_feed.queue_info("Toggle show renderer stats.");
+                        ui_state.special = toggle(ui_state.special, SpecialModes::ShowRenderStats);
+                        Damage::add_all();
+                        break;
+                    case SDLK_F3:
+                        {
+                            const auto trace_path = std::format("cpu-trace-{}.json", SDL_GetTicks());
+                            if (CPUProfiler::write_chrome_trace(trace_path) == Errno::OK)
+                            {
+                                message_feed.queue_info(std::format("CPU trace written to '{}'.", trace_path));
+                            }
+                            else
+                            {
+                                message_feed.queue_error(std::format("Could not write CPU trace '{}'.", trace_path));
+                            }
+                        }
+                        break;
+                    case SDLK_F4:
+                        message_feed.queue_info("Toggle show GPU timings.");
+                        ui_state.special = toggle(ui_state.special, SpecialModes::ShowGPUTimings);
+                        GPUProfiler::enable(implies(ui_state.special, SpecialModes::ShowGPUTimings));
+                        Damage::add_all();
+                        break;
                     case SDLK_F5:
                         message_feed.queue_info("Toggle show FPS.");
                         ui_state.special = toggle(ui_state.special, SpecialModes::ShowFPS);
+                        Damage::add_all();
                         break;
                     case SDLK_F1:
                         if (cmd_mode == CommandMode::None)
@@ -707,6 +901,7 @@ int main()
                         {
                             cmd_mode = CommandMode::None;
                         }
+                        Damage::add_all();
                         break;
 
                     default:
@@ -733,65 +928,147 @@ int main()
             }
         }
 
-        if (not implies(ui_state.special, SpecialModes::SuspendRendering))
+        // Saving a shader reloads it, which is not something a headless run should pick up halfway through.
+        if (not options.headless)
+        {
+            Render::SceneRenderer::watch_shaders(asset_path, &message_feed);
+        }
+        // A finished shader reload changes how everything looks.
+        if (Render::SceneRenderer::poll_program_builds())
+        {
+            Damage::add_all();
+        }
+
+        // A hidden window never gains focus, so headless runs ignore the suspend.
+        const bool rendering = options.headless or not implies(ui_state.special, SpecialModes::SuspendRendering);
+        Damage::FrameDamage frame_damage;
+        if (rendering)
+        {
+            // Headless runs measure whole frames, and the diagnostics change every frame.
+            if (options.headless
+                or implies(ui_state.special, SpecialModes::ShowFPS)
+                or implies(ui_state.special, SpecialModes::ShowGPUTimings)
+                or implies(ui_state.special, SpecialModes::ShowRenderStats)
+                or implies(ui_state.special, SpecialModes::ShowGlyphs))
+            {
+                Damage::add_all();
+            }
+            // Help blurs what is under it, which cannot be redone for a part of the frame.
+            if (cmd_mode == CommandMode::Help and Damage::pending())
+            {
+                Damage::add_all();
+            }
+            frame_damage = Damage::take(screen);
+        }
+
+        // Only what is damaged is drawn again, the rest of 'Framebuffer::Default' is kept from the last frame.
+        if (rendering and not frame_damage.empty)
         {
             const Uint32 start = rep(ticks_since_app_start());
 
             // Setup the primary framebuffer.
-            renderer.bind_framebuffer(Render::Framebuffer::Default);
-            glEnable(GL_BLEND);
-            renderer.apply_blending_mode(Render::BlendingMode::Default);
+            {
+                GPUProfiler::Scope gpu_scope{ "Clear" };
+                renderer.bind_framebuffer(Render::Framebuffer::Default);
+                if (not frame_damage.full)
+                {
+                    Render::SceneRenderer::clip_to_damage(frame_damage.region);
+                }
+                glEnable(GL_BLEND);
+                renderer.apply_blending_mode(Render::BlendingMode::Default);
 
-            const Vec4f bg = Config::system_colors().background;
-            renderer.reset_current_buffer(bg);
+                const Vec4f bg = Config::system_colors().background;
+                renderer.reset_current_buffer(bg);
+            }
 
             // Primary render.
             // We will wrap 'time' for the renderer so that we do not hit floating point limitations.
             // Wrap this at 60 minutes (or 60m * 60s * 1000ms).
             constexpr Uint32 wrap_time = 60 * 60 * 1000;
             const float wrapped_time = static_cast<float>(start % wrap_time) / 1000.f;
-            renderer.update_time(wrapped_time);
+            for (Render::SceneRenderer* frame_renderer : frame_renderers)
+            {
+                frame_renderer->update_time(wrapped_time);
+            }
+
+            // Widgets flush often, so record their draws and let the renderer merge them.  Panels are recorded on
+            // the worker pool while this thread records the rest of their layer; the glyph atlas is read-only
+            // meanwhile.  The commands of a layer are submitted here once its renderers end, in the order they
+            // began.
+            atlas.begin_snapshot();
+            renderer.begin_command_recording();
+            panel_renderer.begin_command_recording();
+
+            // Scroll box.
+            if (not scroll_window_closed and Damage::intersects(frame_damage, scroll_window_viewport))
+            {
+                workers.submit([&]
+                {
+                    auto vp = panel_renderer.create_scissor_viewport(screen);
+                    // Primary window first.
+                    vp.apply_viewport(scroll_window_viewport);
+                    scroll_window.render(&panel_renderer, &atlas, scroll_window_viewport);
+
+                    // Then scroll container.
+                    auto scroll_viewport = scroll_window.content_viewport(scroll_window_viewport);
+                    vp.reset_viewport();
+                    vp.apply_viewport(scroll_viewport);
+                    scroll_box.render(&panel_renderer, scroll_viewport);
+
+                    // Finally content.
+                    auto viewport_content = scroll_box.content_viewport(scroll_viewport);
+                    vp.reset_viewport();
+                    vp.apply_viewport(viewport_content);
+                    text_box.render(&panel_renderer, &atlas, viewport_content);
+                });
+            }
 
             ex_intro.render(&renderer, &atlas, screen);
 
             // Put Drag'n snap on the bottom.
+            if (Damage::intersects(frame_damage, drag_n_snap_viewport))
             {
                 auto vp = renderer.create_scissor_viewport(screen);
                 vp.apply_viewport(drag_n_snap_viewport);
                 ex_dragnsnap.render(&renderer, &atlas, drag_n_snap_viewport);
             }
 
-            // Scroll box.
-            if (not scroll_window_closed)
+            workers.wait();
             {
-                auto vp = renderer.create_scissor_viewport(screen);
-                // Primary window first.
-                vp.apply_viewport(scroll_window_viewport);
-                scroll_window.render(&renderer, &atlas, scroll_window_viewport);
-
-                // Then scroll container.
-                auto scroll_viewport = scroll_window.content_viewport(scroll_window_viewport);
-                vp.reset_viewport();
-                vp.apply_viewport(scroll_viewport);
-                scroll_box.render(&renderer, scroll_viewport);
-
-                // Finally content.
-                auto viewport_content = scroll_box.content_viewport(scroll_viewport);
-                vp.reset_viewport();
-                vp.apply_viewport(viewport_content);
-                text_box.render(&renderer, &atlas, viewport_content);
+                // Recorded widgets reach the GPU here.
+                GPUProfiler::Scope gpu_scope{ "Widgets: examples and panels" };
+                // Text drawn with stand-ins for what missed the snapshot is drawn again next frame.
+                if (atlas.end_snapshot())
+                {
+                    Damage::add_all();
+                }
+                panel_renderer.end_command_recording();
+                renderer.end_command_recording();
             }
 
+            // Help blurs whatever is drawn so far, so it cannot share a layer.
             switch (cmd_mode)
             {
             case CommandMode::None:
                 break;
             case CommandMode::Help:
-                help.render(&renderer, &atlas, screen);
+                {
+                    GPUProfiler::Scope gpu_scope{ "Help" };
+                    renderer.begin_command_recording();
+                    help.render(&renderer, &atlas, screen);
+                    renderer.end_command_recording();
+                }
                 break;
             }
 
-            message_feed.render_queue(&renderer, &atlas, screen);
+            atlas.begin_snapshot();
+            feed_renderer.begin_command_recording();
+            renderer.begin_command_recording();
+
+            workers.submit([&]
+            {
+                message_feed.render_queue(&feed_renderer, &atlas, screen);
+            });
 
             // Draw some FPS.
             if (implies(ui_state.special, SpecialModes::ShowFPS))
@@ -816,10 +1093,107 @@ int main()
                 fps_font_ctx.flush(&renderer);
             }
 
+            // GPU timings go under the FPS.
+            if (implies(ui_state.special, SpecialModes::ShowGPUTimings))
+            {
+                const bool update_timings_txt = (last_update - last_gpu_timings_update) > 250;
+                if (update_timings_txt)
+                {
+                    gpu_timing_lines.clear();
+                    float total_ms = 0.f;
+                    for (const GPUProfiler::ScopeTiming& timing : GPUProfiler::scope_timings())
+                    {
+                        if (timing.depth == 0)
+                        {
+                            total_ms += timing.average_ms;
+                        }
+                        gpu_timing_lines.push_back(std::format("{:{}}{}: {:.3f}ms (last {:.3f}ms)",
+                                                                "",
+                                                                timing.depth * 2,
+                                                                timing.name,
+                                                                timing.average_ms,
+                                                                timing.last_ms));
+                    }
+                    gpu_timing_lines.insert(gpu_timing_lines.begin(),
+                                            std::format("GPU: {:.3f}ms (average of {} frames) | dropped frames: {}",
+                                                        total_ms,
+                                                        GPUProfiler::average_window,
+                                                        GPUProfiler::dropped_frames()));
+                    last_gpu_timings_update = last_update;
+                }
+                constexpr Vec4f color = hex_to_vec4f(0x7FB0D8FF);
+                renderer.set_shader(Render::VertShader::OneOneTransform);
+                renderer.set_shader(Render::FragShader::Text);
+                constexpr auto timings_font_size = Glyph::FontSize{ 20 };
+                auto timings_font_ctx = atlas.render_font_context(timings_font_size);
+                // Leave room for the FPS line.
+                Vec2f pos{ 10.f, rep(screen.height) - 32.f - 10.f - rep(timings_font_size) };
+                for (const std::string& line : gpu_timing_lines)
+                {
+                    timings_font_ctx.render_text(&renderer, line, pos, color);
+                    pos.x = 10.f;
+                    pos.y -= static_cast<float>(timings_font_ctx.current_font_line_height());
+                }
+                timings_font_ctx.flush(&renderer);
+            }
+
+            // Renderer stats go in the top right corner, next to the FPS.
+            if (implies(ui_state.special, SpecialModes::ShowRenderStats))
+            {
+                const bool update_stats_txt = (last_update - last_render_stats_update) > 250;
+                if (update_stats_txt)
+                {
+                    const Render::FrameStats& stats = Render::SceneRenderer::frame_stats();
+                    render_stats_lines = {
+                        std::format("GL draws: {} ({} forced by the stream cap)", stats.gl_draws, stats.cap_forced_draws),
+                        std::format("recorded draws: {} -> {} merged", stats.draws_recorded, stats.draws_submitted),
+                        std::format("flushes: {} | vertices: {}", stats.flushes, stats.vertices_emitted),
+                        std::format("shader switches: {} | programs: {} linked, {} from cache",
+                                    stats.shader_switches,
+                                    Render::SceneRenderer::program_stats().programs_linked,
+                                    Render::SceneRenderer::program_stats().programs_loaded),
+                        std::format("texture binds: {} ({} requested) | flushes: {} ({} avoided)",
+                                    stats.texture_binds,
+                                    stats.texture_bind_requests,
+                                    stats.texture_flushes,
+                                    stats.texture_flushes_avoided),
+                        std::format("framebuffer binds: {} | acquired: {} | allocations: {}",
+                                    stats.framebuffer_binds,
+                                    stats.framebuffers_acquired,
+                                    stats.render_target_allocations),
+                        std::format("texture uploads: {:.1f}KiB", stats.texture_upload_bytes / 1024.f),
+                        std::format("retained quads: {} | uploads: {:.1f}KiB",
+                                    stats.retained_quads,
+                                    stats.retained_upload_bytes / 1024.f),
+                        std::format("cached layers: {} ({} redrawn)", stats.layers_composited, stats.layers_redrawn),
+                        std::format("fence waits: {} ({:.2f}ms) | segment advances: {}",
+                                    stats.fence_waits,
+                                    stats.fence_wait_ms,
+                                    stats.vertex_segment_advances),
+                    };
+                    last_render_stats_update = last_update;
+                }
+                constexpr Vec4f color = hex_to_vec4f(0x8FC07FFF);
+                renderer.set_shader(Render::VertShader::OneOneTransform);
+                renderer.set_shader(Render::FragShader::Text);
+                constexpr auto stats_font_size = Glyph::FontSize{ 20 };
+                auto stats_font_ctx = atlas.render_font_context(stats_font_size);
+                constexpr float padding = 10.f;
+                float y = rep(screen.height) - padding - rep(stats_font_size);
+                for (const std::string& line : render_stats_lines)
+                {
+                    const float width = stats_font_ctx.measure_text(line).x;
+                    stats_font_ctx.render_text(&renderer, line, { rep(screen.width) - padding - width, y }, color);
+                    y -= static_cast<float>(stats_font_ctx.current_font_line_height());
+                }
+                stats_font_ctx.flush(&renderer);
+            }
+
             if (implies(ui_state.special, SpecialModes::ShowGlyphs))
             {
                 renderer.set_shader(Render::VertShader::NoTransform);
                 renderer.set_shader(Render::FragShader::Image);
+                atlas.select_primary_texture(&renderer);
                 auto width = rep(screen.width);
                 auto height = rep(screen.height);
                 renderer.render_image(Vec2f(-width + 0.f, 0.f),
@@ -830,6 +1204,22 @@ int main()
                 renderer.flush();
             }
 
+            workers.wait();
+            {
+                GPUProfiler::Scope gpu_scope{ "Widgets: feed and overlays" };
+                if (atlas.end_snapshot())
+                {
+                    Damage::add_all();
+                }
+                feed_renderer.end_command_recording();
+                renderer.end_command_recording();
+            }
+
+            if (not frame_damage.full)
+            {
+                Render::SceneRenderer::remove_damage_clip();
+            }
+
             // Before we can apply the frame buffer, we must first disable image blending otherwise we will see
             // odd artifacts from blending the current frame buffer with the image on the default frame buffer.
             glDisable(GL_BLEND);
@@ -841,16 +1231,67 @@ int main()
             fps = 1.f / ((turnover_ticks - last_update) / 1000.f);
             last_update = start;
 
-            // Swap the buffer.
-            SDL_GL_SwapWindow(window);
+            Render::SceneRenderer::end_frame();
+            GPUProfiler::end_frame();
+
+            if (not startup_reported)
+            {
+                startup_reported = true;
+                const Render::ProgramStats& programs = Render::SceneRenderer::program_stats();
+                auto msg = std::format("First frame after {:.1f}ms ({} programs linked, {} from the program cache, {} shaders compiled in {:.1f}ms{}).",
+                                        static_cast<double>(CPUProfiler::now_ns() - startup_ns) / 1e6,
+                                        programs.programs_linked,
+                                        programs.programs_loaded,
+                                        programs.stages_compiled,
+                                        programs.build_ms,
+                                        programs.parallel_compile ? ", parallel compile" : "");
+                if (options.headless)
+                {
+                    printf("%s\n", msg.c_str());
+                }
+                message_feed.queue_info(msg);
+            }
+
+            if (options.headless)
+            {
+                // There is nothing to present, but wait for the frame so each one is measured in full.
+                CPU_PROFILE_SCOPE("Finish");
+                glFinish();
+                if (++headless_frames_rendered == options.headless_frames)
+                {
+                    quit = true;
+                }
+            }
+            else
+            {
+                // Swap the buffer.
+                CPU_PROFILE_SCOPE("Swap");
+                SDL_GL_SwapWindow(window);
+            }
         }
         else
         {
-            // Provide some delay so the CPU does not poll events as fast as possible.
+            // Provide some delay so the CPU does not poll events as fast as possible (this is also where a frame
+            // with nothing to draw ends up).
             constexpr auto target_fps_delta_ms = 16;
             SDL_Delay(target_fps_delta_ms);
         }
     }
+    if (options.headless)
+    {
+        const double total_ms = static_cast<double>(CPUProfiler::now_ns() - headless_start_ns) / 1e6;
+        printf("Rendered %d frames at %dx%d in %.3fms (%.3fms/frame)\n",
+               headless_frames_rendered,
+               rep(screen.width),
+               rep(screen.height),
+               total_ms,
+               total_ms / headless_frames_rendered);
+    }
+    if (not options.cpu_trace_path.empty()
+        and CPUProfiler::write_chrome_trace(options.cpu_trace_path) != Errno::OK)
+    {
+        fprintf(stderr, "ERROR: Could not write CPU trace '%.*s'\n", static_cast<int>(options.cpu_trace_path.size()), options.cpu_trace_path.data());
+    }
     SDL_Quit();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "render-graph.h"
+
+#include <cassert>
+
+#include <vector>
+
+#include "gpu-profiler.h"
+#include "vec.h"
+
+namespace Render
+{
+    namespace
+    {
+        enum class TargetKind
+        {
+            Window,
+            Imported,
+            Transient
+        };
+
+        struct TargetData
+        {
+            TargetKind kind = TargetKind::Transient;
+            // The framebuffer imported, or the one acquired for a transient target while it is alive.
+            Framebuffer framebuffer = Framebuffer::Default;
+            TargetScale scale = TargetScale::Full;
+            bool acquired = false;
+
+            // Worked out by 'RenderGraph::execute'.
+            // Whether a pass later on reads what is in the target.
+            bool needed = false;
+            // The last pass reading the target, after which its framebuffer goes back to the pool.
+            size_t last_read = 0;
+        };
+
+        ScreenDimensions scaled_screen(const ScreenDimensions& screen, TargetScale scale)
+        {
+            const int downscale = downscale_factor(scale);
+            return { .width = Width{ (rep(screen.width) + downscale - 1) / downscale },
+                        .height = Height{ (rep(screen.height) + downscale - 1) / downscale } };
+        }
+    } // namespace [anon]
+
+    struct RenderGraph::Data
+    {
+        std::vector<TargetData> targets;
+        std::vector<GraphPass> passes;
+        // Which passes the last 'execute' ran.
+        std::vector<bool> live;
+        int culled = 0;
+    };
+
+    namespace
+    {
+        GraphTarget add_target(RenderGraph::Data* data, const TargetData& target)
+        {
+            data->targets.push_back(target);
+            return GraphTarget{ static_cast<int>(data->targets.size() - 1) };
+        }
+
+        TargetData& target_data(RenderGraph::Data* data, GraphTarget target)
+        {
+            assert(static_cast<size_t>(rep(target)) < data->targets.size());
+            return data->targets[static_cast<size_t>(rep(target))];
+        }
+
+        // Walks back from the targets which outlive the graph to find the passes which contribute to them.
+        void cull_passes(RenderGraph::Data* data)
+        {
+            for (TargetData& target : data->targets)
+            {
+                target.needed = target.kind != TargetKind::Transient;
+                target.last_read = 0;
+            }
+            data->live.assign(data->passes.size(), false);
+            data->culled = 0;
+            for (size_t i = data->passes.size(); i-- != 0;)
+            {
+                const GraphPass& pass = data->passes[i];
+                TargetData& output = target_data(data, pass.output);
+                if (not output.needed)
+                {
+                    ++data->culled;
+                    continue;
+                }
+                data->live[i] = true;
+                // A pass which overwrites a transient target makes what was in there before dead.
+                if (output.kind == TargetKind::Transient and pass.blending == BlendingMode::Replace)
+                {
+                    output.needed = false;
+                }
+                for (GraphTarget read : { pass.input, pass.previous })
+                {
+                    if (read == GraphTarget::Sentinel)
+                        continue;
+                    TargetData& input = target_data(data, read);
+                    assert(input.kind != TargetKind::Window);
+                    if (not input.needed)
+                    {
+                        // The first read found walking back is the last one.
+                        input.last_read = i;
+                    }
+                    input.needed = true;
+                }
+            }
+        }
+
+        void release_target(TargetData* target)
+        {
+            if (target->kind != TargetKind::Transient or not target->acquired)
+                return;
+            SceneRenderer::release_framebuffer(target->framebuffer);
+            target->acquired = false;
+        }
+    } // namespace [anon]
+
+    RenderGraph::RenderGraph():
+        data{ new Data } { }
+
+    RenderGraph::~RenderGraph() = default;
+
+    GraphTarget RenderGraph::import_window()
+    {
+        return add_target(data.get(), { .kind = TargetKind::Window });
+    }
+
+    GraphTarget RenderGraph::import_framebuffer(Framebuffer fb)
+    {
+        return add_target(data.get(), { .kind = TargetKind::Imported, .framebuffer = fb });
+    }
+
+    GraphTarget RenderGraph::create_target(TargetScale scale)
+    {
+        return add_target(data.get(), { .kind = TargetKind::Transient, .scale = scale });
+    }
+
+    void RenderGraph::add_pass(const GraphPass& pass)
+    {
+        assert(pass.input != pass.output and pass.previous != pass.output);
+        data->passes.push_back(pass);
+    }
+
+    void RenderGraph::execute(SceneRenderer* renderer, const ScreenDimensions& screen)
+    {
+        cull_passes(data.get());
+        auto render_viewport = renderer->create_viewport(screen);
+        // Framebuffer renders assume the vert shader is NoTransform.
+        renderer->set_shader(VertShader::NoTransform);
+        for (size_t i = 0; i != data->passes.size(); ++i)
+        {
+            if (not data->live[i])
+                continue;
+            const GraphPass& pass = data->passes[i];
+            GPUProfiler::Scope gpu_scope{ pass.name };
+            TargetData& output = target_data(data.get(), pass.output);
+            const bool first_write = output.kind == TargetKind::Transient and not output.acquired;
+            if (first_write)
+            {
+                output.framebuffer = SceneRenderer::acquire_framebuffer(output.scale);
+                output.acquired = true;
+            }
+            if (output.kind == TargetKind::Window)
+            {
+                renderer->unbind_framebuffer();
+            }
+            else
+            {
+                renderer->bind_framebuffer(output.framebuffer);
+            }
+            const ScreenDimensions pass_screen = scaled_screen(screen, output.scale);
+            render_viewport.apply_viewport(RenderViewport::basic(pass_screen));
+            if (first_write)
+            {
+                // Whatever the framebuffer held was left by someone else.
+                if (pass.blending == BlendingMode::Replace)
+                {
+                    renderer->invalidate_current_buffer();
+                }
+                else
+                {
+                    renderer->reset_current_buffer(hex_to_vec4f(0x00000000));
+                }
+            }
+            renderer->apply_blending_mode(pass.blending);
+            renderer->custom_float_value1(pass.custom_float_value1);
+            renderer->custom_float_value2(pass.custom_float_value2);
+            if (pass.previous != GraphTarget::Sentinel)
+            {
+                renderer->enable_prev_pass_texture(target_data(data.get(), pass.previous).framebuffer);
+            }
+            TargetData& input = target_data(data.get(), pass.input);
+            assert(input.kind != TargetKind::Transient or input.acquired);
+            renderer->set_shader(pass.shader);
+            renderer->render_framebuffer(pass_screen, input.framebuffer);
+
+            // Targets read for the last time can be handed to the passes after this one.
+            for (GraphTarget read : { pass.input, pass.previous })
+            {
+                if (read == GraphTarget::Sentinel)
+                    continue;
+                TargetData& target = target_data(data.get(), read);
+                if (target.last_read == i)
+                {
+                    release_target(&target);
+                }
+            }
+        }
+        // Anything written but never read.
+        for (TargetData& target : data->targets)
+        {
+            release_target(&target);
+        }
+    }
+
+    int RenderGraph::culled_passes() const
+    {
+        return data->culled;
+    }
+} // namespace Render
\ No newline at end of file
@@ -1,16 +1,27 @@
 #include "renderer.h"
 
 #include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 
 #include <algorithm>
+#include <charconv>
 #include <format>
 #include <forward_list>
+#include <mutex>
+#include <span>
+#include <vector>
 
 #include "constants.h"
+#include "cpu-profiler.h"
 #include "enum-utils.h"
 #include "feed.h"
 #include "glew-helpers.h"
+#include "gpu-profiler.h"
 #include "list-helpers.h"
+#include "render-graph.h"
+#include "timers.h"
 #include "util.h"
 #include "vec.h"
 
@@ -40,10 +51,14 @@ namespace Render
                 return "../shaders/basic_color.frag";
             case FragShader::SolidCircle:
                 return "../shaders/solid-circle.frag";
+            case FragShader::Line:
+                return "../shaders/line.frag";
             case FragShader::Image:
                 return "../shaders/image.frag";
             case FragShader::Icon:
                 return "../shaders/icon.frag";
+            case FragShader::UI:
+                return "../shaders/ui.frag";
             case FragShader::Text:
                 return "../shaders/text.frag";
             case FragShader::BasicHSV:
@@ -68,23 +83,26 @@ namespace Render
                 return "../shaders/crt-easymode-threshold.frag";
             case FragShader::CRTEasymodeHalation:
                 return "../shaders/crt-easymode-halation.frag";
+            case FragShader::DualKawaseDown:
+                return "../shaders/dual-kawase-down.frag";
+            case FragShader::DualKawaseUp:
+                return "../shaders/dual-kawase-up.frag";
             }
             return "";
         }
 
+        // Values which are the same for every program live in the 'FrameInputs' uniform block (see
+        // 'FrameInputBlock') so only the per-program values below are looked up by name.
         enum class ShaderUniformLocation
         {
-            Time,
-            Resolution,
-            CameraCoordFactor,
-            CameraPos,
-            CameraScale,
             PreviousPassTexture,
+            TextureSlots,
             CustomFloatValue1,
             CustomFloatValue2,
             CustomVec2Value1,
             CustomVec2Value2,
             CustomVec2Value3,
+            GeometryOffset,
             Count
         };
 
@@ -95,24 +113,12 @@ namespace Render
         };
 
         constexpr ShaderUniformInput uniforms[count_of<ShaderUniformLocation>] {
-            { .locus = ShaderUniformLocation::Time,
-            .name = "time" },
-
-            { .locus = ShaderUniformLocation::Resolution,
-            .name = "resolution" },
-
-            { .locus = ShaderUniformLocation::CameraCoordFactor,
-            .name = "camera_coord_factor" },
-
-            { .locus = ShaderUniformLocation::CameraPos,
-            .name = "camera_pos" },
-
-            { .locus = ShaderUniformLocation::CameraScale,
-            .name = "camera_scale" },
-
             { .locus = ShaderUniformLocation::PreviousPassTexture,
             .name = "prev_pass_tex" },
 
+            { .locus = ShaderUniformLocation::TextureSlots,
+            .name = "texture_slots" },
+
             { .locus = ShaderUniformLocation::CustomFloatValue1,
             .name = "custom_float_value1" },
 
@@ -127,6 +133,9 @@ namespace Render
 
             { .locus = ShaderUniformLocation::CustomVec2Value3,
             .name = "custom_vec2_value3" },
+
+            { .locus = ShaderUniformLocation::GeometryOffset,
+            .name = "geometry_offset" },
         };
 
         static_assert(std::is_sorted(std::begin(uniforms),
@@ -136,6 +145,27 @@ namespace Render
                                         return rep(lhs.locus) < rep(rhs.locus);
                                     }));
 
+        // Mirrors the std140 'FrameInputs' block declared by the shaders.
+        struct FrameInputBlock
+        {
+            Vec2f resolution;
+            Vec2f camera_pos;
+            Vec2f camera_scale;
+            float time = 0.f;
+            float camera_coord_factor = 0.f;
+            // The part of a render target covered by the screen (see 'render_target_extent').
+            Vec2f framebuffer_uv_scale;
+            // std140 rounds the size of the block up to a vec4.
+            Vec2f padding;
+
+            bool operator==(const FrameInputBlock&) const = default;
+        };
+
+        static_assert(sizeof(FrameInputBlock) == 48);
+
+        constexpr const char* frame_inputs_block_name = "FrameInputs";
+        constexpr GLuint frame_inputs_binding = 0;
+
         template <typename T, int BindPosition>
         struct VertexBinding
         {
@@ -159,36 +189,189 @@ namespace Render
             VertexBinding<Vec2f, rep(VertexBindingLocus::UV)> uv;
         };
 
+        // The compact layout (see 'VertexLayout::Compact').  Colors are RGBA8 and UVs are signed so the
+        // [-1, 1] UVs of 'solid_rect' survive the trip.  Both are normalized by the vertex fetch, so shaders
+        // see the same 'vec4' and 'vec2' inputs for either layout.
+        struct PackedColor
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+            uint8_t a;
+        };
+
+        struct PackedUV
+        {
+            int16_t u;
+            int16_t v;
+        };
+
+        struct CompactRenderVertex
+        {
+            VertexBinding<Vec2f, rep(VertexBindingLocus::Position)> pos;
+            VertexBinding<PackedColor, rep(VertexBindingLocus::Color)> color;
+            VertexBinding<PackedUV, rep(VertexBindingLocus::UV)> uv;
+        };
+
+        static_assert(sizeof(CompactRenderVertex) == 16);
+
+        uint8_t pack_unorm8(float x)
+        {
+            return static_cast<uint8_t>(std::clamp(x, 0.f, 1.f) * 255.f + .5f);
+        }
+
+        int16_t pack_snorm16(float x)
+        {
+            const float clamped = std::clamp(x, -1.f, 1.f);
+            return static_cast<int16_t>(clamped * 32767.f + std::copysign(.5f, clamped));
+        }
+
+        CompactRenderVertex pack_vertex(const RenderVertex& vertex)
+        {
+            const Vec4f& c = vertex.color.data;
+            const Vec2f& uv = vertex.uv.data;
+            return { .pos = vertex.pos,
+                    .color = { { pack_unorm8(c.x), pack_unorm8(c.y), pack_unorm8(c.z), pack_unorm8(c.a) } },
+                    .uv = { { pack_snorm16(uv.x), pack_snorm16(uv.y) } } };
+        }
+
+        void write_standard_vertex(std::byte* dest, const RenderVertex& vertex)
+        {
+            std::memcpy(dest, &vertex, sizeof(vertex));
+        }
+
+        void write_compact_vertex(std::byte* dest, const RenderVertex& vertex)
+        {
+            const CompactRenderVertex compact = pack_vertex(vertex);
+            std::memcpy(dest, &compact, sizeof(compact));
+        }
+
+        using VertexWriter = void(*)(std::byte*, const RenderVertex&);
+
+        struct VertexAttributeFormat
+        {
+            GLint components;
+            GLenum type;
+            GLboolean normalized;
+            size_t offset;
+        };
+
+        struct VertexLayoutFormat
+        {
+            GLsizei stride;
+            VertexWriter writer;
+            // Indexed by 'VertexBindingLocus'.
+            VertexAttributeFormat attributes[count_of<VertexBindingLocus>];
+        };
+
+        constexpr VertexLayoutFormat vertex_layout_formats[] = {
+            // VertexLayout::Standard
+            { .stride = sizeof(RenderVertex),
+            .writer = write_standard_vertex,
+            .attributes = {
+                { 2, GL_FLOAT, GL_FALSE, __builtin_offsetof(RenderVertex, pos) },   // Vec2f
+                { 4, GL_FLOAT, GL_FALSE, __builtin_offsetof(RenderVertex, color) }, // Vec4f
+                { 2, GL_FLOAT, GL_FALSE, __builtin_offsetof(RenderVertex, uv) },    // Vec2f
+            } },
+            // VertexLayout::Compact
+            { .stride = sizeof(CompactRenderVertex),
+            .writer = write_compact_vertex,
+            .attributes = {
+                { 2, GL_FLOAT, GL_FALSE, __builtin_offsetof(CompactRenderVertex, pos) },        // Vec2f
+                { 4, GL_UNSIGNED_BYTE, GL_TRUE, __builtin_offsetof(CompactRenderVertex, color) }, // RGBA8 -> vec4
+                { 2, GL_SHORT, GL_TRUE, __builtin_offsetof(CompactRenderVertex, uv) },          // snorm16 -> vec2
+            } },
+        };
+
+        static_assert(std::size(vertex_layout_formats) == count_of<VertexLayout>);
+
         constexpr int vertex_cap = 3 * 25000;
 
         static_assert(vertex_cap % 3 == 0,
             "retain relation that the vertex cap is divisible by 3 since we're rendering triangles.");
 
+        // Every batch starts on a boundary which is a multiple of all the primitive sizes we emit (lines,
+        // triangles, and quads) so that a batch which fills the remainder of a segment never splits a primitive.
+        constexpr int vertex_batch_alignment = 12;
+
+        // Quads are 4 vertices each and are expanded to two triangles through the static index buffer.
+        constexpr int vertices_per_quad = 4;
+        constexpr int indices_per_quad = 6;
+        constexpr int index_cap = vertex_cap / vertices_per_quad * indices_per_quad;
+
+        static_assert(vertex_cap % vertex_batch_alignment == 0,
+            "retain relation that the vertex cap is divisible by the batch alignment.");
+
+        // The number of segments the persistently mapped vertex ring is split into.  One segment is written
+        // by the CPU while the others can still be consumed by the GPU.
+        constexpr int vertex_ring_segments = 3;
+
+        enum class InstanceBindingLocus
+        {
+            Rect = count_of<VertexBindingLocus>,
+            UVRect,
+            Color,
+            TextureSlot,
+            End
+        };
+
+        constexpr int instance_binding_count = rep(InstanceBindingLocus::End) - rep(InstanceBindingLocus::Rect);
+
+        struct PackedUVRect
+        {
+            PackedUV first;
+            PackedUV last;
+        };
+
+        // One quad for the instanced pipeline.  The vertex shader expands the unit quad from 'gl_VertexID'
+        // and interpolates the rect and UVs from the first corner to the last.
+        struct QuadInstance
+        {
+            // xy = first corner, zw = size.
+            VertexBinding<Vec4f, rep(InstanceBindingLocus::Rect)> rect;
+            VertexBinding<PackedUVRect, rep(InstanceBindingLocus::UVRect)> uv_rect;
+            VertexBinding<PackedColor, rep(InstanceBindingLocus::Color)> color;
+            // See 'SceneRenderer::select_texture'.  The bits above the slot carry the 'UIMaterial', see 'pack_material'.
+            VertexBinding<int32_t, rep(InstanceBindingLocus::TextureSlot)> texture_slot;
+        };
+
+        static_assert(sizeof(QuadInstance) == 32);
+
+        constexpr int instance_cap = vertex_cap / vertices_per_quad;
+
         constexpr auto default_reporter = [](const std::string& s)
         {
             fprintf(stderr, "%s\n", s.c_str());
         };
 
+        // GLSL requires '#version' to come first, so any defines go right after it.
+        void splice_shader_defines(std::string* contents, std::string_view defines)
+        {
+            if (defines.empty())
+                return;
+            size_t insert_at = 0;
+            if (contents->starts_with("#version"))
+            {
+                insert_at = contents->find('\n');
+                insert_at = insert_at == std::string::npos ? contents->size() : insert_at + 1;
+            }
+            contents->insert(insert_at, defines);
+        }
+
         template <typename Reporter>
-        Glew::ShaderHandle compile_shader_file(const char* path, Glew::ShaderType type, Reporter&& reporter)
+        bool read_shader_file(const char* path, Reporter&& reporter, std::string* contents, std::string_view defines = { })
         {
-            std::string contents;
-            auto err = read_file(path, &contents);
+            auto err = read_file(path, contents);
             if (err != Errno::OK)
             {
                 char msg[512];
                 strerror_s(msg, rep(err));
                 auto txt = std::format("Failed to load '{}' shader file: {}", path, msg);
                 reporter(txt);
-                return { };
-            }
-            auto handle = Glew::compile_shader(type, contents.c_str(), reporter);
-            if (not handle)
-            {
-                auto txt = std::format("Failed to compile shader file: {}", path);
-                reporter(txt);
+                return false;
             }
-            return handle;
+            splice_shader_defines(contents, defines);
+            return true;
         }
 
         using UniformsContainer = Glew::UniformHandle[count_of<ShaderUniformLocation>];
@@ -200,7 +383,16 @@ namespace Render
             }
         }
 
-        using ShaderProgramContainer = Glew::ScopedProgramHandle[count_of<VertShader>][count_of<FragShader>];
+        // Note: programs which do not reference the block are left alone.
+        void bind_frame_inputs_block(Glew::ProgramHandle program)
+        {
+            const GLuint index = glGetUniformBlockIndex(rep(program), frame_inputs_block_name);
+            if (index != GL_INVALID_INDEX)
+            {
+                glUniformBlockBinding(rep(program), index, frame_inputs_binding);
+            }
+        }
+
         enum class ColorAttachments : GLint
         {
             Default,
@@ -294,6 +486,161 @@ namespace Render
             glCreateTextures(GL_TEXTURE_2D, N, output);
         }
 
+        // Textures sampled through the 'texture_slots' sampler array.  Slot 0 is texture unit 0 (see
+        // 'bind_texture') and the rest skip unit 1, which belongs to 'prev_pass_tex'.
+        constexpr int texture_slot_count = 8;
+        constexpr GLint texture_slot_units[texture_slot_count] = { 0, 2, 3, 4, 5, 6, 7, 8 };
+
+        // Shadow of the GL state which is set outside of 'SceneRenderer::Data' but which affects draws.  It is
+        // captured along with each recorded command.
+        struct PipelineState
+        {
+            GLint framebuffer = 0;
+            // Indexed by texture slot.
+            GLuint textures[texture_slot_count]{};
+            BlendingMode blending = BlendingMode::Default;
+            GLint viewport[4]{};
+            bool scissor = false;
+            GLint scissor_box[4]{};
+
+            bool operator==(const PipelineState&) const = default;
+        };
+
+        PipelineState pipeline_state;
+        FrameStats current_frame_stats;
+        FrameStats last_frame_stats;
+        // The slot stamped into instanced quads.
+        int selected_texture_slot = 0;
+
+        // Cleared by 'SceneRenderer::init_without_gl'.  The shadow state is still tracked, but nothing reaches GL.
+        bool gl_submission = true;
+
+        // See 'SceneRenderer::clip_to_damage'.  The clip is combined with the shadow scissor whenever it is sent to
+        // GL, so the shadow state never includes it.
+        bool damage_clip = false;
+        GLint damage_clip_framebuffer = 0;
+        GLint damage_clip_box[4]{};
+
+        void store_viewport(PipelineState* state, GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            state->viewport[0] = x;
+            state->viewport[1] = y;
+            state->viewport[2] = width;
+            state->viewport[3] = height;
+        }
+
+        void store_scissor(PipelineState* state, GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            state->scissor_box[0] = x;
+            state->scissor_box[1] = y;
+            state->scissor_box[2] = width;
+            state->scissor_box[3] = height;
+        }
+
+        // Sends the scissor of 'state' to GL, confined to the damage clip when 'state' draws into the clipped
+        // framebuffer.
+        void send_gl_scissor(const PipelineState& state)
+        {
+            if (not gl_submission)
+                return;
+            if (damage_clip and state.framebuffer == damage_clip_framebuffer)
+            {
+                GLint x0 = damage_clip_box[0];
+                GLint y0 = damage_clip_box[1];
+                GLint x1 = x0 + damage_clip_box[2];
+                GLint y1 = y0 + damage_clip_box[3];
+                if (state.scissor)
+                {
+                    x0 = std::max(x0, state.scissor_box[0]);
+                    y0 = std::max(y0, state.scissor_box[1]);
+                    x1 = std::min(x1, state.scissor_box[0] + state.scissor_box[2]);
+                    y1 = std::min(y1, state.scissor_box[1] + state.scissor_box[3]);
+                }
+                glEnable(GL_SCISSOR_TEST);
+                glScissor(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+                return;
+            }
+            glScissor(state.scissor_box[0], state.scissor_box[1], state.scissor_box[2], state.scissor_box[3]);
+            if (state.scissor)
+            {
+                glEnable(GL_SCISSOR_TEST);
+            }
+            else
+            {
+                glDisable(GL_SCISSOR_TEST);
+            }
+        }
+
+        void bind_gl_framebuffer(GLuint id)
+        {
+            pipeline_state.framebuffer = static_cast<GLint>(id);
+            glBindFramebuffer(GL_FRAMEBUFFER, id);
+            // The damage clip depends on the framebuffer.
+            send_gl_scissor(pipeline_state);
+        }
+
+        void apply_gl_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            store_viewport(&pipeline_state, x, y, width, height);
+            if (not gl_submission)
+                return;
+            glViewport(x, y, width, height);
+        }
+
+        void apply_gl_scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            store_scissor(&pipeline_state, x, y, width, height);
+            send_gl_scissor(pipeline_state);
+        }
+
+        void enable_gl_scissor(bool enable)
+        {
+            pipeline_state.scissor = enable;
+            send_gl_scissor(pipeline_state);
+        }
+
+        void gl_blend_func(BlendingMode mode)
+        {
+            switch (mode)
+            {
+            case BlendingMode::PremultipliedAlpha:
+                glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case BlendingMode::SrcAlpha:
+                glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case BlendingMode::Default:
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case BlendingMode::Replace:
+                glBlendFunc(GL_ONE, GL_ZERO);
+                break;
+            }
+        }
+
+        void apply_gl_blending(BlendingMode mode)
+        {
+            pipeline_state.blending = mode;
+            if (not gl_submission)
+                return;
+            gl_blend_func(mode);
+        }
+
+        // The texture binding is tracked as it is made.  The rest is read back once since the application also
+        // sets some of it directly (e.g. the viewport on resize).
+        void sync_pipeline_state()
+        {
+            if (not gl_submission)
+                return;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &pipeline_state.framebuffer);
+            glGetIntegerv(GL_VIEWPORT, pipeline_state.viewport);
+            // What GL has is combined with the damage clip, which must not leak into the shadow state.
+            if (damage_clip)
+                return;
+            glGetIntegerv(GL_SCISSOR_BOX, pipeline_state.scissor_box);
+            pipeline_state.scissor = !!glIsEnabled(GL_SCISSOR_TEST);
+        }
+
         GLuint create_texture()
         {
             GLuint id;
@@ -301,20 +648,111 @@ namespace Render
             return id;
         }
 
+        // Deleted textures are unbound from every unit, and their ids may be handed out again.
+        void forget_texture(GLuint id)
+        {
+            for (GLuint& bound : pipeline_state.textures)
+            {
+                if (bound == id)
+                {
+                    bound = 0;
+                }
+            }
+        }
+
         template <int N>
         void delete_textures(GLuint (&output)[N])
         {
+            for (GLuint id : output)
+            {
+                forget_texture(id);
+            }
             glDeleteTextures(N, output);
         }
 
         void delete_texture(GLuint id)
         {
+            forget_texture(id);
             glDeleteTextures(1, &id);
         }
 
+        // Note: 'FrameStats::texture_binds' counts the binds below as if they reached GL, even without it.
         void bind_texture(GLuint id)
         {
+            pipeline_state.textures[0] = id;
+            selected_texture_slot = 0;
+            ++current_frame_stats.texture_binds;
+            if (not gl_submission)
+                return;
+            glBindTexture(GL_TEXTURE_2D, id);
+        }
+
+        void bind_texture_slot(int slot, GLuint id)
+        {
+            if (pipeline_state.textures[slot] == id)
+                return;
+            pipeline_state.textures[slot] = id;
+            ++current_frame_stats.texture_binds;
+            if (not gl_submission)
+                return;
+            glActiveTexture(GL_TEXTURE0 + texture_slot_units[slot]);
             glBindTexture(GL_TEXTURE_2D, id);
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        // Binds the textures of 'state' which differ from 'applied', what GL has bound, and updates 'applied'.
+        // Note: This does not touch the shadow state.
+        void send_gl_textures(const PipelineState& state, PipelineState* applied)
+        {
+            GLint active_unit = 0;
+            for (int slot = 0; slot != texture_slot_count; ++slot)
+            {
+                if (applied->textures[slot] == state.textures[slot])
+                    continue;
+                applied->textures[slot] = state.textures[slot];
+                ++current_frame_stats.texture_binds;
+                if (not gl_submission)
+                    continue;
+                if (active_unit != texture_slot_units[slot])
+                {
+                    active_unit = texture_slot_units[slot];
+                    glActiveTexture(GL_TEXTURE0 + active_unit);
+                }
+                glBindTexture(GL_TEXTURE_2D, state.textures[slot]);
+            }
+            // Unit 0 is always left active.
+            if (active_unit != 0)
+            {
+                glActiveTexture(GL_TEXTURE0);
+            }
+        }
+
+        // Sends the parts of 'state' which differ from 'applied', what GL has, and updates 'applied' to match.
+        // Note: The framebuffer is not bound here, recorded draws are submitted to the one they were recorded against.
+        void send_gl_pipeline(const PipelineState& state, PipelineState* applied)
+        {
+            send_gl_textures(state, applied);
+            const bool same_viewport = std::equal(std::begin(state.viewport), std::end(state.viewport), std::begin(applied->viewport));
+            // The damage clip depends on the framebuffer.
+            const bool same_scissor = state.framebuffer == applied->framebuffer
+                                        and state.scissor == applied->scissor
+                                        and std::equal(std::begin(state.scissor_box), std::end(state.scissor_box), std::begin(applied->scissor_box));
+            const bool same_blending = state.blending == applied->blending;
+            *applied = state;
+            if (not gl_submission)
+                return;
+            if (not same_viewport)
+            {
+                glViewport(state.viewport[0], state.viewport[1], state.viewport[2], state.viewport[3]);
+            }
+            if (not same_scissor)
+            {
+                send_gl_scissor(state);
+            }
+            if (not same_blending)
+            {
+                gl_blend_func(state.blending);
+            }
         }
 
         struct FramebufferData
@@ -322,6 +760,8 @@ namespace Render
             FrameBufferID id;
             GLuint attachments[rep(ColorAttachments::Count)];
             GLuint depth_attachment;
+            // The size the attachments were created at, which can be larger than what is drawn into them.
+            ScreenDimensions allocated;
         };
 
         struct RenderTextureData
@@ -332,131 +772,656 @@ namespace Render
 
         using RenderTextureAlloc = std::forward_list<RenderTextureData>;
 
-        // Global data shared across all renderer instances.
-        GLuint vao;
-        GLuint vbo;
-        ShaderProgramContainer shader_programs;
-        constinit RenderVertex vertices[vertex_cap]{};
-        GLsizei vertices_flush_count = 0;
-        FramebufferData framebuffer_collection[rep(Framebuffer::Count)];
-        RenderTextureAlloc render_texture_allocator;
-#ifndef NDEBUG
-        // This is used to track the implicit dependency by using a single vertex buffer
-        // above.  Two different renderers cannot invoke a render function without first
-        // calling flush.
-        SceneRenderer* current_renderer;
-#endif
-
-        void init_vertex_buffer()
+        enum class VertexStreamMode
         {
-            glGenVertexArrays(1, &vao);
-            glBindVertexArray(vao);
-
-            // Create the vertex buffer data binding.
-            glGenBuffers(1, &vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            // Note: the use of 'sizeof(array)' is intentional because we're providing a total buffer size.
-            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
+            // Single buffer which is orphaned before each upload of the staging data.
+            Orphaning,
+            // Persistently mapped buffer split into 'vertex_ring_segments' segments guarded by fences.
+            PersistentRing,
+        };
 
-            // position
-            glEnableVertexAttribArray(rep(VertexBindingLocus::Position));
-            glVertexAttribPointer(
-                rep(VertexBindingLocus::Position),
-                2, // Vec2f
-                GL_FLOAT,
-                GL_FALSE,
-                sizeof(RenderVertex),
-                (GLvoid *) __builtin_offsetof(RenderVertex, pos));
+        // The kind of primitives in the pending batch.  Mixing kinds forces a flush.
+        enum class BatchTopology
+        {
+            // Drawn from 'vertex_stream' with the static index buffer.
+            IndexedQuads,
+            // Drawn directly from 'vertex_stream'.
+            Triangles,
+            // Drawn from 'instance_stream', one instance per quad.
+            InstancedQuads,
+        };
 
-            // color
-            glEnableVertexAttribArray(rep(VertexBindingLocus::Color));
-            glVertexAttribPointer(
-                rep(VertexBindingLocus::Color),
-                4, // Vec4f
-                GL_FLOAT,
-                GL_FALSE,
-                sizeof(RenderVertex),
-                (GLvoid *) __builtin_offsetof(RenderVertex, color));
+        // Every program is linked once per kind of vertex input.
+        enum class VertexInput
+        {
+            PerVertex,
+            InstancedQuads,
+            Count
+        };
 
-            // uv
-            glEnableVertexAttribArray(rep(VertexBindingLocus::UV));
-            glVertexAttribPointer(
-                rep(VertexBindingLocus::UV),
-                2, // Vec2f
-                GL_FLOAT,
-                GL_FALSE,
-                sizeof(RenderVertex),
-                (GLvoid *) __builtin_offsetof(RenderVertex, uv));
+        constexpr VertexInput vertex_input_for(BatchTopology topology)
+        {
+            return topology == BatchTopology::InstancedQuads ? VertexInput::InstancedQuads
+                                                             : VertexInput::PerVertex;
         }
 
-        void setup_framebuffer_texture_attachments(FramebufferData* data, const ScreenDimensions& screen)
+        // Prepended (after the '#version' line) to vertex shaders compiled for each input.
+        constexpr const char* vertex_input_defines(VertexInput input)
         {
-            create_textures(data->attachments);
-            for (auto i = ColorAttachments{}; i != ColorAttachments::Count; i = extend(i))
+            switch (input)
             {
-                bind_texture(data->attachments[rep(i)]);
-                attach_color_texture(data->attachments[rep(i)], screen, i);
+            case VertexInput::PerVertex:
+                return "";
+            case VertexInput::InstancedQuads:
+                return "#define INSTANCED_QUADS 1\n";
             }
+            return "";
+        }
 
-            // Attach the single depth texture.
-            data->depth_attachment = create_texture();
-            bind_texture(data->depth_attachment);
-            attach_depth_texture(data->depth_attachment, DepthTextureFormat::Depth24Stencil8, screen, DepthAttachment::DepthStencilAttachment);
+        using ShaderProgramContainer = Glew::ScopedProgramHandle[count_of<VertexInput>][count_of<VertShader>][count_of<FragShader>];
+        // Programs which failed to build are not tried again until the shaders are reloaded.
+        using ProgramFailedContainer = bool[count_of<VertexInput>][count_of<VertShader>][count_of<FragShader>];
+        // Programs a frame has drawn with, in this run or an earlier one (see 'save_used_programs').
+        using ProgramUsedContainer = bool[count_of<VertexInput>][count_of<VertShader>][count_of<FragShader>];
 
-            GLenum buffers[rep(ColorAttachments::Count)] = { GL_COLOR_ATTACHMENT0 };
-            glDrawBuffers(GLsizei(std::size(buffers)), buffers);
+        // A shader stage is compiled the first time a program which uses it has to be linked, rather than once for
+        // every program.  The source is kept around to compile from and to key the program cache with.
+        struct ShaderStage
+        {
+            std::string path;
+            std::string source;
+            Glew::ShaderHandle compiled;
+            // Whether the compile status was looked at, which waits for the driver to finish compiling.
+            bool checked = false;
+            bool failed = false;
+        };
 
-            assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-        }
+        struct ShaderStages
+        {
+            ShaderStage vert[count_of<VertexInput>][count_of<VertShader>];
+            ShaderStage frag[count_of<FragShader>];
+        };
 
-        void init_framebuffer(FramebufferData* data, const ScreenDimensions& screen)
+        // A program handed to the driver to build.  With parallel compiles (see 'KHR_parallel_shader_compile') it may
+        // still be compiling and linking in the background until 'program_build_complete' says otherwise.
+        struct ProgramBuild
         {
-            // Right into the DANGER ZONE!!!
-            glCreateFramebuffers(1, reinterpret_cast<GLuint*>(&data->id));
-            glBindFramebuffer(GL_FRAMEBUFFER, rep(data->id));
-            setup_framebuffer_texture_attachments(data, screen);
-            // Bind to the default frame buffer on exit.
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
+            VertexInput input;
+            VertShader vert;
+            FragShader frag;
+            ShaderStage* vert_stage;
+            ShaderStage* frag_stage;
+            Glew::ScopedProgramHandle program;
+            uint64_t key = 0;
+            bool submitted = false;
+            // Loaded from the program cache, so there was nothing to compile.
+            bool from_cache = false;
+        };
 
-        void update_framebuffer_size(FramebufferData* data, const ScreenDimensions& screen)
+        // Replacement programs for those which use a reloaded shader file (see 'SceneRenderer::reload_shaders' and
+        // 'SceneRenderer::watch_shaders').  The programs in use are only replaced once every replacement has built,
+        // so a mistake in any shader leaves the old ones in place.
+        struct ShaderReload
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, rep(data->id));
+            // Only the reloaded stages are filled in, the other stages of the programs are the ones in use.
+            ShaderStages stages;
+            bool vert_reloaded[count_of<VertexInput>][count_of<VertShader>]{};
+            bool frag_reloaded[count_of<FragShader>]{};
+            // Posted to the feed once the reload is done.
+            std::string done_message;
+            std::vector<ProgramBuild> builds;
+            // Builds are submitted and finished in order.
+            size_t next_submit = 0;
+            size_t next_finish = 0;
+            Feed::MessageFeed* feed = nullptr;
+        };
 
-            // Destroy all of the old textures.
-            delete_textures(data->attachments);
-            delete_texture(data->depth_attachment);
+        // Without parallel compiles a build blocks until it is done, so a reload is spread over several frames.
+        constexpr size_t reload_builds_per_frame = 4;
 
-            setup_framebuffer_texture_attachments(data, screen);
-        }
+        // The shader files, vertex shaders first, as 'SceneRenderer::watch_shaders' goes through them.
+        constexpr int shader_file_count = count_of<VertShader> + count_of<FragShader>;
+        using ShaderFileFlags = bool[shader_file_count];
 
-        void screen_update(const ScreenDimensions& screen)
+        const char* shader_file_path(int file)
         {
-            for (auto& data : framebuffer_collection)
-            {
-                update_framebuffer_size(&data, screen);
-            }
-            // Bind to the default frame buffer on exit.
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (file < count_of<VertShader>)
+                return builtin_vert_shader_path(VertShader{ file });
+            return builtin_frag_shader_path(FragShader{ file - count_of<VertShader> });
         }
 
-        enum class TextureUnit : GLuint
+        // Polled by 'SceneRenderer::watch_shaders'.
+        struct ShaderWatch
         {
-            Sentinel = sentinel_for<TextureUnit>
+            std::string asset_core_path;
+            uint64_t write_times[shader_file_count]{};
+            ShaderFileFlags changed{};
+            Ticks last_poll{};
+            // Editors often write a file more than once when saving, so a reload waits until the files have been
+            // left alone for a moment.
+            Ticks last_change{};
         };
 
-        RenderTexture alloc_render_texture()
+        constexpr unsigned int shader_watch_poll_ms = 250;
+        constexpr unsigned int shader_watch_debounce_ms = 200;
+
+        // Written in front of every program binary in the program cache.
+        struct ProgramBinaryHeader
         {
-            render_texture_allocator.emplace_front();
-            RenderTextureData* tex = &render_texture_allocator.front();
-            RenderTexture handle = RenderTexture{ reinterpret_cast<size_t>(tex) };
-            return handle;
-        }
+            uint32_t magic;
+            GLenum format;
+            uint64_t key;
+        };
 
-        RenderTextureData* render_texture_data(RenderTexture tex)
+        constexpr uint32_t program_binary_magic = 0x50495542; // 'BUIP'.
+
+        // A streaming array buffer.  All counts are in elements of 'stride' bytes.
+        struct StreamBuffer
         {
-#ifndef NDEBUG
-            // Ensure that the node is in the list.
+            GLuint buffer = 0;
+            VertexStreamMode mode = VertexStreamMode::Orphaning;
+            GLsizei stride = 0;
+            // Elements per segment.
+            GLsizei cap = 0;
+            // Batches start on a multiple of this so primitives never straddle the end of a segment.
+            GLsizei alignment = 1;
+            // CPU storage uploaded by the orphaning mode.
+            std::byte* staging = nullptr;
+            // Where new elements are written.  For the orphaning mode this is 'staging', for the ring
+            // it is the start of the current segment in the mapped buffer.
+            std::byte* write_base = nullptr;
+            std::byte* mapped = nullptr;
+            GLsync fences[vertex_ring_segments]{};
+            int segment = 0;
+            // The first element (relative to 'write_base') of the batch which has not been drawn yet.
+            GLsizei batch_start = 0;
+            // The write cursor relative to 'write_base'.
+            GLsizei count = 0;
+        };
+
+        // Geometry built by one renderer.  Each renderer owns one, so renderers never have to flush for each
+        // other, and it grows as needed so it never has to be flushed early either.  Elements have the
+        // stride of the stream they will be copied to (see 'arena_stride').
+        struct VertexArena
+        {
+            BatchTopology topology = BatchTopology::IndexedQuads;
+            std::vector<std::byte> bytes;
+            GLsizei count = 0;
+        };
+
+        constexpr size_t min_arena_bytes = 64 * 1024;
+
+        // Global data shared across all renderer instances.
+        // Note: 'vertices' and 'instances' are only the upload staging of the streams, geometry is built in each
+        // renderer's 'VertexArena'.
+        GLuint vao;
+        GLuint quad_ibo;
+        GLuint frame_inputs_ubo;
+        ShaderProgramContainer shader_programs;
+        ProgramFailedContainer program_failed{};
+        ProgramUsedContainer program_used{};
+        // Set when 'program_used' has programs which are not saved yet.
+        bool program_used_changed = false;
+        ShaderStages shader_stages;
+        // Empty when programs are not cached.
+        std::string program_cache_dir;
+        // Program binaries are only good for the driver which produced them, so this is part of every cache key.
+        std::string program_cache_driver;
+        ProgramStats program_build_stats;
+        bool parallel_shader_compile = false;
+        // Programs the driver builds in the background after startup, see 'submit_background_builds'.
+        std::vector<ProgramBuild> background_builds;
+        std::unique_ptr<ShaderReload> shader_reload;
+        ShaderWatch shader_watch;
+        constinit RenderVertex vertices[vertex_cap]{};
+        constinit QuadInstance instances[instance_cap]{};
+        StreamBuffer vertex_stream;
+        StreamBuffer instance_stream;
+        VertexWriter vertex_writer = write_standard_vertex;
+        // The batch being submitted to the streams.
+        BatchTopology batch_topology = BatchTopology::IndexedQuads;
+        FramebufferData framebuffer_collection[rep(Framebuffer::Count)];
+        RenderTextureAlloc render_texture_allocator;
+
+        // Framebuffers handed out by 'SceneRenderer::acquire_framebuffer'.  Their handles follow the named
+        // framebuffers, so 'Framebuffer{ rep(Framebuffer::Count) + i }' refers to 'framebuffer_pool[i]'.
+        struct PooledFramebuffer
+        {
+            FramebufferData data{};
+            // The framebuffer is allocated at 'render_target_extent' divided by this.
+            int downscale = 1;
+            bool in_use = false;
+            // Frames ended since the framebuffer was released (see 'trim_framebuffer_pool').
+            int idle_frames = 0;
+        };
+
+        // Released framebuffers give their attachments back after going unused for this many frames.
+        constexpr int framebuffer_pool_idle_frames = 120;
+
+        std::vector<PooledFramebuffer> framebuffer_pool;
+
+        PooledFramebuffer* pooled_framebuffer(Framebuffer fb)
+        {
+            if (rep(fb) < rep(Framebuffer::Count))
+                return nullptr;
+            const auto index = static_cast<size_t>(rep(fb) - rep(Framebuffer::Count));
+            assert(index < framebuffer_pool.size() and framebuffer_pool[index].in_use);
+            return &framebuffer_pool[index];
+        }
+
+        GLsizei arena_stride(BatchTopology topology)
+        {
+            return topology == BatchTopology::InstancedQuads ? GLsizei{ sizeof(QuadInstance) } : vertex_stream.stride;
+        }
+
+        // Returns where the next element of 'stride' bytes goes.
+        std::byte* push_arena_element(VertexArena* arena, GLsizei stride)
+        {
+            const size_t offset = size_t(arena->count) * stride;
+            if (offset + stride > arena->bytes.size())
+            {
+                arena->bytes.resize(std::max({ offset + stride, arena->bytes.size() * 2, min_arena_bytes }));
+            }
+            ++arena->count;
+            return arena->bytes.data() + offset;
+        }
+
+        void init_stream_buffer(StreamBuffer* stream, GLsizei stride, GLsizei cap, GLsizei alignment, void* staging)
+        {
+            stream->stride = stride;
+            stream->cap = cap;
+            stream->alignment = alignment;
+            stream->staging = static_cast<std::byte*>(staging);
+            const GLsizeiptr segment_size = GLsizeiptr{ cap } * stride;
+
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+            if (GLEW_ARB_buffer_storage)
+            {
+                // Elements are written straight into GPU-visible memory, so we never need to copy the staging data.
+                constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                const GLsizeiptr ring_size = segment_size * vertex_ring_segments;
+                glBufferStorage(GL_ARRAY_BUFFER, ring_size, nullptr, flags);
+                stream->mapped = static_cast<std::byte*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, ring_size, flags));
+            }
+
+            if (stream->mapped != nullptr)
+            {
+                stream->mode = VertexStreamMode::PersistentRing;
+                stream->write_base = stream->mapped;
+            }
+            else
+            {
+                stream->mode = VertexStreamMode::Orphaning;
+                stream->write_base = stream->staging;
+                glBufferData(GL_ARRAY_BUFFER, segment_size, nullptr, GL_STREAM_DRAW);
+            }
+        }
+
+        // Points the instance attributes at 'buffer', starting from instance 'first'.
+        void bind_instance_batch(GLuint buffer, GLintptr first)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            const GLintptr base = first * sizeof(QuadInstance);
+            // rect
+            glVertexAttribPointer(
+                rep(InstanceBindingLocus::Rect),
+                4, // Vec4f
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(QuadInstance),
+                (GLvoid *) (base + __builtin_offsetof(QuadInstance, rect)));
+            // uv rect
+            glVertexAttribPointer(
+                rep(InstanceBindingLocus::UVRect),
+                4, // 2 x snorm16 UV -> vec4
+                GL_SHORT,
+                GL_TRUE,
+                sizeof(QuadInstance),
+                (GLvoid *) (base + __builtin_offsetof(QuadInstance, uv_rect)));
+            // color
+            glVertexAttribPointer(
+                rep(InstanceBindingLocus::Color),
+                4, // RGBA8 -> vec4
+                GL_UNSIGNED_BYTE,
+                GL_TRUE,
+                sizeof(QuadInstance),
+                (GLvoid *) (base + __builtin_offsetof(QuadInstance, color)));
+            // texture slot
+            glVertexAttribIPointer(
+                rep(InstanceBindingLocus::TextureSlot),
+                1, // int
+                GL_INT,
+                sizeof(QuadInstance),
+                (GLvoid *) (base + __builtin_offsetof(QuadInstance, texture_slot)));
+        }
+
+        // Every program reads the values shared across programs from this one binding.
+        void init_frame_inputs_buffer()
+        {
+            glGenBuffers(1, &frame_inputs_ubo);
+            glBindBuffer(GL_UNIFORM_BUFFER, frame_inputs_ubo);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameInputBlock), nullptr, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, frame_inputs_binding, frame_inputs_ubo);
+        }
+
+        void init_vertex_buffer(VertexLayout layout)
+        {
+            const VertexLayoutFormat& format = vertex_layout_formats[rep(layout)];
+            vertex_writer = format.writer;
+
+            glGenVertexArrays(1, &vao);
+            glBindVertexArray(vao);
+
+            // Create the vertex buffer data binding.
+            // Note: 'vertices' is sized for the largest layout.
+            init_stream_buffer(&vertex_stream, format.stride, vertex_cap, vertex_batch_alignment, vertices);
+
+            // The quad index pattern never changes, so it is built once and the batch offset is applied
+            // through the base vertex of each draw.
+            {
+                std::vector<GLuint> indices(index_cap);
+                for (GLuint quad = 0; quad < vertex_cap / vertices_per_quad; ++quad)
+                {
+                    const GLuint base = quad * vertices_per_quad;
+                    GLuint* dest = indices.data() + quad * indices_per_quad;
+                    // 2 - 3
+                    // | \ |
+                    // 0 - 1
+                    dest[0] = base + 0;
+                    dest[1] = base + 1;
+                    dest[2] = base + 2;
+                    dest[3] = base + 1;
+                    dest[4] = base + 2;
+                    dest[5] = base + 3;
+                }
+                // Note: the element array binding is part of the VAO state.
+                glGenBuffers(1, &quad_ibo);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+            }
+
+            // position, color, uv
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_stream.buffer);
+            for (int i = 0; i < count_of<VertexBindingLocus>; ++i)
+            {
+                const VertexAttributeFormat& attribute = format.attributes[i];
+                glEnableVertexAttribArray(i);
+                glVertexAttribPointer(
+                    i,
+                    attribute.components,
+                    attribute.type,
+                    attribute.normalized,
+                    format.stride,
+                    (GLvoid *) attribute.offset);
+            }
+
+            // The instance attributes live in the same VAO.  Per-vertex programs simply never read them.
+            // Note: the pointers are set per batch in 'bind_instance_batch' since the batch offset cannot be
+            // expressed through the instanced draw without base instance support.
+            init_stream_buffer(&instance_stream, sizeof(QuadInstance), instance_cap, 1, instances);
+            for (int i = 0; i < instance_binding_count; ++i)
+            {
+                const GLuint locus = rep(InstanceBindingLocus::Rect) + i;
+                glEnableVertexAttribArray(locus);
+                glVertexAttribDivisor(locus, 1);
+            }
+            bind_instance_batch(instance_stream.buffer, 0);
+        }
+
+        void wait_for_stream_segment(GLsync* fence)
+        {
+            if (*fence == nullptr)
+                return;
+            // Poll first, most of the time the GPU is well past this segment.
+            GLenum result = glClientWaitSync(*fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                ++current_frame_stats.fence_waits;
+                Timers::Stopwatch watch;
+                watch.start();
+                constexpr GLuint64 wait_timeout_ns = 1'000'000'000;
+                do
+                {
+                    result = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait_timeout_ns);
+                } while (result == GL_TIMEOUT_EXPIRED);
+                watch.stop();
+                current_frame_stats.fence_wait_ms += watch.to_ticks<std::chrono::duration<float, std::milli>>().count();
+            }
+            glDeleteSync(*fence);
+            *fence = nullptr;
+        }
+
+        void advance_stream_segment(StreamBuffer* stream)
+        {
+            // Fence everything issued against the segment we're leaving so we know when it can be reused.
+            stream->fences[stream->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            stream->segment = (stream->segment + 1) % vertex_ring_segments;
+            wait_for_stream_segment(&stream->fences[stream->segment]);
+            stream->write_base = stream->mapped + GLsizeiptr{ stream->segment } * stream->cap * stream->stride;
+            stream->batch_start = 0;
+            stream->count = 0;
+            ++current_frame_stats.vertex_segment_advances;
+        }
+
+        GLint stream_batch_first(const StreamBuffer& stream)
+        {
+            if (stream.write_base == stream.staging)
+                return 0;
+            return stream.segment * stream.cap + stream.batch_start;
+        }
+
+        GLsizei stream_batch_count(const StreamBuffer& stream)
+        {
+            return stream.count - stream.batch_start;
+        }
+
+        void upload_stream_batch(const StreamBuffer& stream)
+        {
+            if (stream.write_base != stream.staging)
+                return;
+            // Orphan the old storage so the driver can hand us a fresh allocation rather than waiting on
+            // a draw which may still be reading the previous contents.
+            glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+            glBufferData(GL_ARRAY_BUFFER, GLsizeiptr{ stream.cap } * stream.stride, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER,
+                            0,
+                            stream_batch_count(stream) * stream.stride,
+                            stream.staging);
+        }
+
+        // Called after the pending batch was drawn.
+        void retire_stream_batch(StreamBuffer* stream)
+        {
+            // Anything written to staging memory has been consumed by now.
+            if (stream->write_base == stream->staging)
+            {
+                stream->count = 0;
+                return;
+            }
+            const GLsizei aligned = (stream->count + stream->alignment - 1) / stream->alignment * stream->alignment;
+            if (aligned >= stream->cap)
+            {
+                advance_stream_segment(stream);
+                return;
+            }
+            stream->batch_start = aligned;
+            stream->count = aligned;
+        }
+
+        StreamBuffer* batch_stream()
+        {
+            return batch_topology == BatchTopology::InstancedQuads ? &instance_stream : &vertex_stream;
+        }
+
+        // Issues the draw for the pending batch of 'batch_topology'.
+        void draw_batch()
+        {
+            switch (batch_topology)
+            {
+            case BatchTopology::IndexedQuads:
+                glDrawElementsBaseVertex(GL_TRIANGLES,
+                                        stream_batch_count(vertex_stream) / vertices_per_quad * indices_per_quad,
+                                        GL_UNSIGNED_INT,
+                                        nullptr,
+                                        stream_batch_first(vertex_stream));
+                break;
+            case BatchTopology::Triangles:
+                glDrawArrays(GL_TRIANGLES, stream_batch_first(vertex_stream), stream_batch_count(vertex_stream));
+                break;
+            case BatchTopology::InstancedQuads:
+                bind_instance_batch(instance_stream.buffer, stream_batch_first(instance_stream));
+                // The unit quad is expanded from 'gl_VertexID' as a strip: 0 - 1, 2 - 3.
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, vertices_per_quad, stream_batch_count(instance_stream));
+                break;
+            }
+        }
+
+        // Uploads, draws, and retires the pending batch.
+        void submit_stream_batch()
+        {
+            StreamBuffer* stream = batch_stream();
+            if (stream_batch_count(*stream) == 0)
+                return;
+            upload_stream_batch(*stream);
+            draw_batch();
+            ++current_frame_stats.gl_draws;
+            retire_stream_batch(stream);
+        }
+
+        void setup_framebuffer_texture_attachments(FramebufferData* data, const ScreenDimensions& screen)
+        {
+            create_textures(data->attachments);
+            for (auto i = ColorAttachments{}; i != ColorAttachments::Count; i = extend(i))
+            {
+                bind_texture(data->attachments[rep(i)]);
+                attach_color_texture(data->attachments[rep(i)], screen, i);
+            }
+
+            // Attach the single depth texture.
+            data->depth_attachment = create_texture();
+            bind_texture(data->depth_attachment);
+            attach_depth_texture(data->depth_attachment, DepthTextureFormat::Depth24Stencil8, screen, DepthAttachment::DepthStencilAttachment);
+
+            GLenum buffers[rep(ColorAttachments::Count)] = { GL_COLOR_ATTACHMENT0 };
+            glDrawBuffers(GLsizei(std::size(buffers)), buffers);
+
+            assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        }
+
+        void init_framebuffer(FramebufferData* data, const ScreenDimensions& screen)
+        {
+            // Right into the DANGER ZONE!!!
+            glCreateFramebuffers(1, reinterpret_cast<GLuint*>(&data->id));
+            glBindFramebuffer(GL_FRAMEBUFFER, rep(data->id));
+            setup_framebuffer_texture_attachments(data, screen);
+            data->allocated = screen;
+            // Bind to the default frame buffer on exit.
+            bind_gl_framebuffer(0);
+        }
+
+        void update_framebuffer_size(FramebufferData* data, const ScreenDimensions& screen)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, rep(data->id));
+
+            // Destroy all of the old textures.
+            delete_textures(data->attachments);
+            delete_texture(data->depth_attachment);
+
+            setup_framebuffer_texture_attachments(data, screen);
+            data->allocated = screen;
+        }
+
+        void delete_framebuffer(FramebufferData* data)
+        {
+            delete_textures(data->attachments);
+            delete_texture(data->depth_attachment);
+            glDeleteFramebuffers(1, reinterpret_cast<GLuint*>(&data->id));
+            *data = { };
+        }
+
+        // Render targets are not allocated at the exact size of the screen but in steps of 1.5x from this one.
+        // Everything is drawn into the lower left corner of a target (the viewport stays the size of the screen) so
+        // resizing the window only reallocates the targets once the screen leaves its current step.
+        constexpr int min_render_target_extent = 256;
+
+        // What the framebuffers are drawn at and allocated at.  'screen_update' only records these, the
+        // framebuffers catch up the next time they are used (see 'ensure_framebuffer_storage').
+        ScreenDimensions render_target_screen{};
+        ScreenDimensions render_target_extent{};
+        // 'render_target_screen' over 'render_target_extent'.  The shaders get this through 'FrameInputs' to map
+        // the part of a target covered by the screen to and from [0, 1].
+        Vec2f framebuffer_uv_scale{ 1.f, 1.f };
+
+        int render_target_step(int current, int requested)
+        {
+            // Keep the allocation for as long as the request fits and covers more than half of it, so going back
+            // and forth around a step does not reallocate each time.
+            if (requested <= current and requested * 2 > current)
+                return current;
+            // Steps are rounded up to a multiple of 16 so that the reduced framebuffers (see 'TargetScale') are
+            // covered by the screen in the same proportion as the full ones.
+            int extent = min_render_target_extent;
+            while (extent < requested)
+            {
+                extent = (extent + extent / 2 + 15) / 16 * 16;
+            }
+            return extent;
+        }
+
+        bool same_size(const ScreenDimensions& a, const ScreenDimensions& b)
+        {
+            return a.width == b.width and a.height == b.height;
+        }
+
+        void screen_update(const ScreenDimensions& screen)
+        {
+            render_target_screen = screen;
+            render_target_extent = { .width = Width{ render_target_step(rep(render_target_extent.width), rep(screen.width)) },
+                                     .height = Height{ render_target_step(rep(render_target_extent.height), rep(screen.height)) } };
+            framebuffer_uv_scale = Vec2f(static_cast<float>(rep(screen.width)) / rep(render_target_extent.width),
+                                         static_cast<float>(rep(screen.height)) / rep(render_target_extent.height));
+        }
+
+        // Render textures as large as the screen share the extent of the framebuffers, so that shaders sampling
+        // them can rely on 'framebuffer_uv_scale' as well.  Any other size takes its own steps.
+        ScreenDimensions render_texture_extent(const ScreenDimensions& current, const ScreenDimensions& size)
+        {
+            if (same_size(size, render_target_screen))
+                return render_target_extent;
+            return { .width = Width{ render_target_step(rep(current.width), rep(size.width)) },
+                     .height = Height{ render_target_step(rep(current.height), rep(size.height)) } };
+        }
+
+        void trim_framebuffer_pool()
+        {
+            for (PooledFramebuffer& entry : framebuffer_pool)
+            {
+                if (entry.in_use or rep(entry.data.id) == 0)
+                    continue;
+                if (++entry.idle_frames < framebuffer_pool_idle_frames)
+                    continue;
+                delete_framebuffer(&entry.data);
+            }
+        }
+
+        enum class TextureUnit : GLuint
+        {
+            Sentinel = sentinel_for<TextureUnit>
+        };
+
+        RenderTexture alloc_render_texture()
+        {
+            render_texture_allocator.emplace_front();
+            RenderTextureData* tex = &render_texture_allocator.front();
+            RenderTexture handle = RenderTexture{ reinterpret_cast<size_t>(tex) };
+            return handle;
+        }
+
+        RenderTextureData* render_texture_data(RenderTexture tex)
+        {
+#ifndef NDEBUG
+            // Ensure that the node is in the list.
             RenderTextureData* data = reinterpret_cast<RenderTextureData*>(rep(tex));
             bool found = false;
             for (RenderTextureData& e : render_texture_allocator)
@@ -480,20 +1445,22 @@ namespace Render
         void init_render_texture(RenderTextureData* data, const ScreenDimensions& screen)
         {
             data->size = screen;
-            init_framebuffer(&data->data, screen);
+            init_framebuffer(&data->data, render_texture_extent(ScreenDimensions{ }, screen));
         }
 
         void update_render_texture(RenderTextureData* data, const ScreenDimensions& screen)
         {
             data->size = screen;
-            update_framebuffer_size(&data->data, screen);
+            const ScreenDimensions extent = render_texture_extent(data->data.allocated, screen);
+            // A size within the current step only changes the part of the texture drawn into.
+            if (same_size(extent, data->data.allocated))
+                return;
+            update_framebuffer_size(&data->data, extent);
         }
 
         void delete_render_texture(RenderTextureData* data)
         {
-            delete_textures(data->data.attachments);
-            delete_texture(data->data.depth_attachment);
-            glDeleteFramebuffers(1, reinterpret_cast<GLuint*>(&data->data.id));
+            delete_framebuffer(&data->data);
         }
     } // namespace [anon]
 
@@ -589,262 +1556,1752 @@ namespace Render
                     .height = screen.height };
     }
 
-    ScopedRenderViewport::ScopedRenderViewport(RenderViewport old, SceneRenderer* renderer):
-        current{ old }, old_viewport{ old }, renderer{ renderer } { }
-
-    ScopedRenderViewport::~ScopedRenderViewport()
+    ScissorRegion ScissorRegion::basic(const ScreenDimensions& screen)
     {
-        reset_viewport();
+        return { .offset_x = ScissorOffsetX{ },
+                    .offset_y = ScissorOffsetY{ },
+                    .width = screen.width,
+                    .height = screen.height };
     }
 
-    void ScopedRenderViewport::apply_viewport(RenderViewport viewport)
+    ScopedScissorRegion::~ScopedScissorRegion()
     {
-        // This ensures that pixels snap to an even number.
-        current = viewport;
-        float w = static_cast<float>(current.width);
-        if ((rep(current.width) & 1) == 1)
-        {
-            w += 1.0;
-            current.width = extend(current.width);
-        }
-        float h = static_cast<float>(current.height);
-        if ((rep(current.height) & 1) == 1)
-        {
-            h += 1.0;
-            current.height = extend(current.height);
-        }
-        glViewport(rep(current.offset_x),
-                    rep(current.offset_y),
-                    rep(current.width),
-                    rep(current.height));
-        renderer->resolution(Vec2f(w, h));
+        remove_scissor();
     }
 
-    void ScopedRenderViewport::reset_viewport()
+    void ScopedScissorRegion::apply_scissor(const ScissorRegion& region)
     {
-        apply_viewport(old_viewport);
+        enable_scissor();
+        apply_gl_scissor(rep(region.offset_x),
+                    rep(region.offset_y),
+                    rep(region.width),
+                    rep(region.height));
     }
 
-    ScopedRenderViewport ScopedRenderViewport::sub() const
+    void ScopedScissorRegion::enable_scissor()
     {
-        return { current, renderer };
+        enable_gl_scissor(true);
     }
 
-    ScopedRenderViewportScissor::ScopedRenderViewportScissor(RenderViewport old):
-        current{ old }, old_viewport{ old }, old_scissor{ !!glIsEnabled(GL_SCISSOR_TEST) } { }
-
-    ScopedRenderViewportScissor::~ScopedRenderViewportScissor()
+    void ScopedScissorRegion::remove_scissor()
     {
-        reset_viewport();
+        enable_gl_scissor(false);
     }
 
-    void ScopedRenderViewportScissor::apply_viewport(RenderViewport viewport)
+    namespace
     {
-        current = viewport;
-        glEnable(GL_SCISSOR_TEST);
-        glViewport(rep(current.offset_x),
-                    rep(current.offset_y),
-                    // We retain the resolution of the original viewport.
-                    rep(old_viewport.width),
-                    rep(old_viewport.height));
-        // Apply scissor.
-        glScissor(rep(current.offset_x),
-                    rep(current.offset_y),
-                    rep(current.width),
-                    rep(current.height));
-    }
+        // The values uploaded to a program's uniforms.
+        struct ShaderInputs
+        {
+            Vec2f resolution;
+            float time = 0.f;
+            Camera camera;
+            float custom_float_value1 = 0.f;
+            float custom_float_value2 = 0.f;
+            Vec2f custom_vec2_value1;
+            Vec2f custom_vec2_value2;
+            Vec2f custom_vec2_value3;
+            // Only set for retained draws (see 'SceneRenderer::draw_retained_geometry').
+            Vec2f geometry_offset;
+            TextureUnit previous_texture = TextureUnit::Sentinel;
+
+            bool operator==(const ShaderInputs&) const = default;
+        };
 
-    void ScopedRenderViewportScissor::reset_viewport()
+        // Per-program uniform state.  Locations are resolved once after linking and the values last uploaded are
+        // kept so only the ones which changed are sent to the driver.
+        struct ProgramUniforms
+        {
+            UniformsContainer locations{};
+            ShaderInputs uploaded;
+            bool uploaded_valid = false;
+        };
+
+        using ProgramUniformsContainer = ProgramUniforms[count_of<VertexInput>][count_of<VertShader>][count_of<FragShader>];
+        ProgramUniformsContainer program_uniforms;
+        GLuint bound_program = 0;
+        FrameInputBlock uploaded_frame_inputs;
+        bool frame_inputs_valid = false;
+
+        // Must be called for every program after it is (re)linked.
+        void init_program_uniforms(Glew::ProgramHandle program, ProgramUniforms* state)
+        {
+            populate_uniform_locations(program, &state->locations);
+            state->uploaded_valid = false;
+            bind_frame_inputs_block(program);
+            // The samplers never move off of their texture units so they only need to be set once.
+            // NOTE: The value is NOT the texture id but rather the unit to which the texture is associated.
+            glUseProgram(rep(program));
+            glUniform1i(rep(state->locations[rep(ShaderUniformLocation::PreviousPassTexture)]), 1);
+            glUniform1iv(rep(state->locations[rep(ShaderUniformLocation::TextureSlots)]), texture_slot_count, texture_slot_units);
+            glUseProgram(bound_program);
+        }
+
+        void use_program(GLuint program)
+        {
+            if (bound_program == program)
+                return;
+            bound_program = program;
+            glUseProgram(program);
+        }
+
+        void upload_frame_inputs(const ShaderInputs& inputs)
+        {
+            const FrameInputBlock block{ .resolution = inputs.resolution,
+                                        .camera_pos = inputs.camera.pos,
+                                        .camera_scale = inputs.camera.scale,
+                                        .time = inputs.time,
+                                        .camera_coord_factor = Constants::shader_scale_factor,
+                                        .framebuffer_uv_scale = framebuffer_uv_scale };
+            if (frame_inputs_valid and block == uploaded_frame_inputs)
+                return;
+            glBindBuffer(GL_UNIFORM_BUFFER, frame_inputs_ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+            uploaded_frame_inputs = block;
+            frame_inputs_valid = true;
+        }
+
+        // Note: This assumes the program owning 'state' is in use.
+        void upload_shader_inputs(ProgramUniforms* state, const ShaderInputs& inputs)
+        {
+            upload_frame_inputs(inputs);
+            const UniformsContainer& uniforms = state->locations;
+            const ShaderInputs& uploaded = state->uploaded;
+            const bool valid = state->uploaded_valid;
+            if (not valid or uploaded.custom_float_value1 != inputs.custom_float_value1)
+            {
+                glUniform1f(rep(uniforms[rep(ShaderUniformLocation::CustomFloatValue1)]), inputs.custom_float_value1);
+            }
+            if (not valid or uploaded.custom_float_value2 != inputs.custom_float_value2)
+            {
+                glUniform1f(rep(uniforms[rep(ShaderUniformLocation::CustomFloatValue2)]), inputs.custom_float_value2);
+            }
+            if (not valid or uploaded.custom_vec2_value1 != inputs.custom_vec2_value1)
+            {
+                glUniform2f(rep(uniforms[rep(ShaderUniformLocation::CustomVec2Value1)]), inputs.custom_vec2_value1.x, inputs.custom_vec2_value1.y);
+            }
+            if (not valid or uploaded.custom_vec2_value2 != inputs.custom_vec2_value2)
+            {
+                glUniform2f(rep(uniforms[rep(ShaderUniformLocation::CustomVec2Value2)]), inputs.custom_vec2_value2.x, inputs.custom_vec2_value2.y);
+            }
+            if (not valid or uploaded.custom_vec2_value3 != inputs.custom_vec2_value3)
+            {
+                glUniform2f(rep(uniforms[rep(ShaderUniformLocation::CustomVec2Value3)]), inputs.custom_vec2_value3.x, inputs.custom_vec2_value3.y);
+            }
+            if (not valid or uploaded.geometry_offset != inputs.geometry_offset)
+            {
+                glUniform2f(rep(uniforms[rep(ShaderUniformLocation::GeometryOffset)]), inputs.geometry_offset.x, inputs.geometry_offset.y);
+            }
+            if (inputs.previous_texture != TextureUnit::Sentinel)
+            {
+                // Now we can bind it to texture unit 1.
+                // Note: we do not go through 'bind_texture' since that tracks texture unit 0.  This is not skipped
+                // when unchanged because texture unit 1 is not tracked either.
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, rep(inputs.previous_texture));
+                // We also keep texture unit 0 as the active texture unit for future binding since the bind above
+                // is a 1-off thing.
+                glActiveTexture(GL_TEXTURE0);
+            }
+            state->uploaded = inputs;
+            state->uploaded_valid = true;
+        }
+
+        void init_program_cache(std::string_view cache_dir)
+        {
+            program_cache_dir.clear();
+            if (cache_dir.empty() or not (GLEW_VERSION_4_1 or GLEW_ARB_get_program_binary))
+                return;
+            // Some drivers expose the extension without supporting a single binary format.
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            if (formats == 0)
+                return;
+            program_cache_dir = cache_dir;
+            auto gl_string = [](GLenum name)
+            {
+                const GLubyte* str = glGetString(name);
+                return str != nullptr ? reinterpret_cast<const char*>(str) : "";
+            };
+            program_cache_driver = std::format("{}|{}|{}", gl_string(GL_VENDOR), gl_string(GL_RENDERER), gl_string(GL_VERSION));
+        }
+
+        // Reads the stages compiled from the shader files flagged in 'files'.
+        template <typename Reporter>
+        bool read_shader_stages(std::string_view asset_core_path, const ShaderFileFlags& files, ShaderStages* stages, Reporter&& reporter)
+        {
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    if (not files[v])
+                        continue;
+                    ShaderStage* stage = &stages->vert[i][v];
+                    stage->path = combine_paths(asset_core_path, builtin_vert_shader_path(VertShader{ v }));
+                    if (not read_shader_file(stage->path.c_str(), reporter, &stage->source, vertex_input_defines(VertexInput{ i })))
+                        return false;
+                }
+            }
+            for (int f = 0; f != count_of<FragShader>; ++f)
+            {
+                if (not files[count_of<VertShader> + f])
+                    continue;
+                ShaderStage* stage = &stages->frag[f];
+                stage->path = combine_paths(asset_core_path, builtin_frag_shader_path(FragShader{ f }));
+                if (not read_shader_file(stage->path.c_str(), reporter, &stage->source))
+                    return false;
+            }
+            return true;
+        }
+
+        // Compiling is only started here, see 'check_stage'.
+        void submit_stage(ShaderStage* stage, Glew::ShaderType type)
+        {
+            if (stage->compiled or stage->failed)
+                return;
+            stage->compiled = Glew::submit_shader(type, stage->source.c_str());
+            stage->failed = not stage->compiled;
+        }
+
+        template <typename Reporter>
+        bool check_stage(ShaderStage* stage, Glew::ShaderType type, Reporter&& reporter)
+        {
+            if (stage->checked or stage->failed)
+                return not stage->failed;
+            stage->checked = true;
+            if (not Glew::check_shader(stage->compiled, type, reporter))
+            {
+                auto txt = std::format("Failed to compile shader file: {}", stage->path);
+                reporter(txt);
+                stage->failed = true;
+                return false;
+            }
+            ++program_build_stats.stages_compiled;
+            return true;
+        }
+
+        // FNV-1a.  Each text is followed by a null so that moving text from one to the next changes the hash.
+        uint64_t hash_text(uint64_t hash, std::string_view text)
+        {
+            for (char c : text)
+            {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+            }
+            return hash * 0x100000001B3ull;
+        }
+
+        uint64_t program_cache_key(const ShaderStage& vert, const ShaderStage& frag)
+        {
+            uint64_t hash = 0xCBF29CE484222325ull;
+            hash = hash_text(hash, program_cache_driver);
+            hash = hash_text(hash, vert.source);
+            return hash_text(hash, frag.source);
+        }
+
+        std::string program_cache_path(uint64_t key)
+        {
+            return combine_paths(program_cache_dir, std::format("{:016x}.bin", key));
+        }
+
+        bool load_program_binary(Glew::ProgramHandle program, uint64_t key)
+        {
+            std::string contents;
+            if (read_file(program_cache_path(key), &contents) != Errno::OK or contents.size() <= sizeof(ProgramBinaryHeader))
+                return false;
+            ProgramBinaryHeader header;
+            std::memcpy(&header, contents.data(), sizeof(header));
+            if (header.magic != program_binary_magic or header.key != key)
+                return false;
+            glProgramBinary(rep(program),
+                            header.format,
+                            contents.data() + sizeof(header),
+                            static_cast<GLsizei>(contents.size() - sizeof(header)));
+            // Drivers reject binaries from other versions of themselves, in which case the program is built as usual.
+            GLint success = GL_FALSE;
+            glGetProgramiv(rep(program), GL_LINK_STATUS, &success);
+            return success == GL_TRUE;
+        }
+
+        void save_program_binary(Glew::ProgramHandle program, uint64_t key)
+        {
+            GLint length = 0;
+            glGetProgramiv(rep(program), GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0)
+                return;
+            std::string contents(sizeof(ProgramBinaryHeader) + length, '\0');
+            ProgramBinaryHeader header{ .magic = program_binary_magic, .key = key };
+            glGetProgramBinary(rep(program), length, nullptr, &header.format, contents.data() + sizeof(header));
+            std::memcpy(contents.data(), &header, sizeof(header));
+            // A program which could not be saved is simply built again on the next run.
+            (void)save_file(program_cache_path(key), contents);
+        }
+
+        std::string used_programs_path()
+        {
+            return combine_paths(program_cache_dir, "used-programs.txt");
+        }
+
+        // Reads the programs earlier runs drew with into 'program_used'.  Returns false when there is no list, as on
+        // a first run.
+        bool load_used_programs()
+        {
+            std::string contents;
+            if (program_cache_dir.empty() or read_file(used_programs_path(), &contents) != Errno::OK)
+                return false;
+            // One 'input vert frag' line per program.  Lines from a build with other shaders are skipped.
+            std::string_view text = contents;
+            while (not text.empty())
+            {
+                const size_t eol = text.find('\n');
+                std::string_view line = text.substr(0, eol);
+                text = eol == std::string_view::npos ? std::string_view{ } : text.substr(eol + 1);
+                int ids[3];
+                const int counts[3] = { count_of<VertexInput>, count_of<VertShader>, count_of<FragShader> };
+                bool valid = true;
+                for (int n = 0; n != 3 and valid; ++n)
+                {
+                    while (not line.empty() and line.front() == ' ')
+                    {
+                        line.remove_prefix(1);
+                    }
+                    auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), ids[n]);
+                    valid = ec == std::errc{} and ids[n] >= 0 and ids[n] < counts[n];
+                    line.remove_prefix(ptr - line.data());
+                }
+                if (valid)
+                {
+                    program_used[ids[0]][ids[1]][ids[2]] = true;
+                }
+            }
+            return true;
+        }
+
+        void save_used_programs()
+        {
+            program_used_changed = false;
+            if (program_cache_dir.empty())
+                return;
+            std::string contents;
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    for (int f = 0; f != count_of<FragShader>; ++f)
+                    {
+                        if (program_used[i][v][f])
+                        {
+                            contents += std::format("{} {} {}\n", i, v, f);
+                        }
+                    }
+                }
+            }
+            // Without the list the next run just starts as a first run would.
+            (void)save_file(used_programs_path(), contents);
+        }
+
+        void init_parallel_shader_compile(bool allowed)
+        {
+            // Let the driver pick how many threads to compile on.
+            constexpr GLuint driver_default_threads = 0xFFFFFFFF;
+            parallel_shader_compile = allowed;
+            if (not allowed)
+                return;
+            if (GLEW_KHR_parallel_shader_compile)
+            {
+                glMaxShaderCompilerThreadsKHR(driver_default_threads);
+            }
+            else if (GLEW_ARB_parallel_shader_compile)
+            {
+                glMaxShaderCompilerThreadsARB(driver_default_threads);
+            }
+            else
+            {
+                parallel_shader_compile = false;
+            }
+        }
+
+        // Adds the time until the end of the scope to 'ProgramStats::build_ms'.
+        struct BuildTimer
+        {
+            BuildTimer()
+            {
+                watch.start();
+            }
+
+            ~BuildTimer()
+            {
+                watch.stop();
+                program_build_stats.build_ms += watch.to_ticks<std::chrono::duration<float, std::milli>>().count();
+            }
+
+            Timers::Stopwatch watch;
+        };
+
+        // Loads the program from the program cache when it is there.  Otherwise whichever of its stages were not
+        // submitted yet are compiled and the program is linked, neither of which is waited on here.
+        void submit_program_build(ProgramBuild* build)
+        {
+            BuildTimer timer;
+            build->submitted = true;
+            ShaderStage* vert_stage = build->vert_stage;
+            ShaderStage* frag_stage = build->frag_stage;
+            build->key = program_cache_key(*vert_stage, *frag_stage);
+            if (not program_cache_dir.empty())
+            {
+                build->program = Glew::ScopedProgramHandle{ Glew::ProgramHandle{ glCreateProgram() } };
+                build->from_cache = load_program_binary(build->program.handle(), build->key);
+                if (build->from_cache)
+                    return;
+            }
+            submit_stage(vert_stage, Glew::ShaderType::Vertex);
+            submit_stage(frag_stage, Glew::ShaderType::Fragment);
+            if (vert_stage->failed or frag_stage->failed)
+            {
+                build->program = { };
+                return;
+            }
+            build->program = Glew::attach_and_create_program(Glew::VertexShaderHandle{ vert_stage->compiled.handle() },
+                                                            Glew::FragmentShaderHandle{ frag_stage->compiled.handle() });
+            if (not program_cache_dir.empty())
+            {
+                glProgramParameteri(rep(build->program.handle()), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            Glew::submit_link(build->program.handle());
+        }
+
+        // Whether 'finish_program_build' can be called without waiting on the driver.
+        bool program_build_complete(const ProgramBuild& build)
+        {
+            assert(build.submitted);
+            if (not parallel_shader_compile or build.from_cache or not build.program)
+                return true;
+            GLint complete = GL_FALSE;
+            glGetProgramiv(rep(build.program.handle()), GL_COMPLETION_STATUS_KHR, &complete);
+            return complete == GL_TRUE;
+        }
+
+        // Reports any errors and caches the program if it built.  Otherwise the program is dropped.
+        template <typename Reporter>
+        bool finish_program_build(ProgramBuild* build, Reporter&& reporter)
+        {
+            BuildTimer timer;
+            if (build->from_cache)
+            {
+                ++program_build_stats.programs_loaded;
+                return true;
+            }
+            const bool compiled = check_stage(build->vert_stage, Glew::ShaderType::Vertex, reporter)
+                                    and check_stage(build->frag_stage, Glew::ShaderType::Fragment, reporter);
+            if (not compiled or not Glew::check_program(build->program.handle(), reporter))
+            {
+                build->program = { };
+                return false;
+            }
+            ++program_build_stats.programs_linked;
+            if (not program_cache_dir.empty())
+            {
+                save_program_binary(build->program.handle(), build->key);
+            }
+            return true;
+        }
+
+        // A build of a program from the stages in use.
+        ProgramBuild live_program_build(VertexInput input, VertShader vert, FragShader frag)
+        {
+            return { .input = input,
+                     .vert = vert,
+                     .frag = frag,
+                     .vert_stage = &shader_stages.vert[rep(input)][rep(vert)],
+                     .frag_stage = &shader_stages.frag[rep(frag)] };
+        }
+
+        void install_program(ProgramBuild* build)
+        {
+            Glew::ScopedProgramHandle& program = shader_programs[rep(build->input)][rep(build->vert)][rep(build->frag)];
+            program = std::move(build->program);
+            program_failed[rep(build->input)][rep(build->vert)][rep(build->frag)] = not program;
+            if (program)
+            {
+                init_program_uniforms(program.handle(), &program_uniforms[rep(build->input)][rep(build->vert)][rep(build->frag)]);
+            }
+        }
+
+        // With parallel compiles the driver starts on what the first frames are likely to need, and
+        // 'poll_program_builds' installs the programs once they are complete.  Given the programs earlier runs drew
+        // with ('used_programs_known'), those missing from the program cache are built; the ones in it are left for
+        // 'ensure_program' to load when first used, which is quick, rather than loading them all here.  Without the
+        // list, as on a first run, only the shader stages are compiled so that the first use of a program just links
+        // it.  Without parallel compiles programs are only built when they are first used.
+        void submit_background_builds(bool used_programs_known)
+        {
+            background_builds.clear();
+            if (not parallel_shader_compile)
+                return;
+            if (not used_programs_known)
+            {
+                BuildTimer timer;
+                for (int i = 0; i != count_of<VertexInput>; ++i)
+                {
+                    for (int v = 0; v != count_of<VertShader>; ++v)
+                    {
+                        submit_stage(&shader_stages.vert[i][v], Glew::ShaderType::Vertex);
+                    }
+                }
+                for (int f = 0; f != count_of<FragShader>; ++f)
+                {
+                    submit_stage(&shader_stages.frag[f], Glew::ShaderType::Fragment);
+                }
+                return;
+            }
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    for (int f = 0; f != count_of<FragShader>; ++f)
+                    {
+                        if (not program_used[i][v][f])
+                            continue;
+                        ProgramBuild build = live_program_build(VertexInput{ i }, VertShader{ v }, FragShader{ f });
+                        if (file_exists(program_cache_path(program_cache_key(*build.vert_stage, *build.frag_stage))))
+                            continue;
+                        submit_program_build(&build);
+                        background_builds.push_back(std::move(build));
+                    }
+                }
+            }
+        }
+
+        // Programs are built the first time they are used, waiting on the build from startup if there is one.  A
+        // program which fails to build stays 0, which draws nothing, until the shaders are reloaded.
+        Glew::ProgramHandle ensure_program(VertexInput input, VertShader vert, FragShader frag)
+        {
+            const Glew::ScopedProgramHandle& program = shader_programs[rep(input)][rep(vert)][rep(frag)];
+            if (program or program_failed[rep(input)][rep(vert)][rep(frag)])
+                return program.handle();
+            ProgramBuild build = live_program_build(input, vert, frag);
+            auto found = std::find_if(background_builds.begin(), background_builds.end(), [&](const ProgramBuild& b)
+            {
+                return b.input == input and b.vert == vert and b.frag == frag;
+            });
+            if (found != background_builds.end())
+            {
+                build = std::move(*found);
+                background_builds.erase(found);
+            }
+            else
+            {
+                submit_program_build(&build);
+            }
+            finish_program_build(&build, default_reporter);
+            install_program(&build);
+            return program.handle();
+        }
+
+        // Returns true when the reload replaced the programs in use.
+        bool poll_shader_reload()
+        {
+            if (shader_reload == nullptr)
+                return false;
+            ShaderReload* reload = shader_reload.get();
+            auto reporter = [&](const std::string& s)
+            {
+                reload->feed->queue_error(s);
+            };
+            const size_t submit_end = parallel_shader_compile ? reload->builds.size()
+                                                              : std::min(reload->builds.size(), reload->next_finish + reload_builds_per_frame);
+            for (; reload->next_submit < submit_end; ++reload->next_submit)
+            {
+                submit_program_build(&reload->builds[reload->next_submit]);
+            }
+            while (reload->next_finish != reload->next_submit
+                    and program_build_complete(reload->builds[reload->next_finish]))
+            {
+                if (not finish_program_build(&reload->builds[reload->next_finish], reporter))
+                {
+                    // Keep the programs we have.
+                    shader_reload = nullptr;
+                    return false;
+                }
+                ++reload->next_finish;
+            }
+            if (reload->next_finish != reload->builds.size())
+                return false;
+
+            // Success!  Let's move them all over.
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    if (reload->vert_reloaded[i][v])
+                    {
+                        shader_stages.vert[i][v] = std::move(reload->stages.vert[i][v]);
+                    }
+                }
+            }
+            for (int f = 0; f != count_of<FragShader>; ++f)
+            {
+                if (reload->frag_reloaded[f])
+                {
+                    shader_stages.frag[f] = std::move(reload->stages.frag[f]);
+                }
+            }
+            // Whatever is still building from startup with a reloaded stage was built from the old source.
+            std::erase_if(background_builds, [&](const ProgramBuild& build)
+            {
+                return reload->vert_reloaded[rep(build.input)][rep(build.vert)] or reload->frag_reloaded[rep(build.frag)];
+            });
+            // The old programs are deleted along with the reload, so nothing we know of will be bound anymore.
+            bound_program = 0;
+            for (ProgramBuild& build : reload->builds)
+            {
+                install_program(&build);
+            }
+            // Layers were drawn with the old programs.
+            CachedLayer::invalidate_all();
+            reload->feed->queue_info(reload->done_message);
+            shader_reload = nullptr;
+            return true;
+        }
+
+        // Rebuilds every program which uses one of the shader files flagged in 'files' (see 'shader_file_path'), with
+        // the files read again from 'asset_core_path'.  A reload still in progress is abandoned for this one.
+        void start_shader_reload(std::string_view asset_core_path, const ShaderFileFlags& files, Feed::MessageFeed* feed)
+        {
+            auto reporter = [&](const std::string& s)
+            {
+                feed->queue_error(s);
+            };
+            auto reload = std::make_unique<ShaderReload>();
+            if (not read_shader_stages(asset_core_path, files, &reload->stages, reporter))
+                return;
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    reload->vert_reloaded[i][v] = files[v];
+                }
+            }
+            for (int f = 0; f != count_of<FragShader>; ++f)
+            {
+                reload->frag_reloaded[f] = files[count_of<VertShader> + f];
+            }
+            for (int i = 0; i != count_of<VertexInput>; ++i)
+            {
+                for (int v = 0; v != count_of<VertShader>; ++v)
+                {
+                    for (int f = 0; f != count_of<FragShader>; ++f)
+                    {
+                        if (not reload->vert_reloaded[i][v] and not reload->frag_reloaded[f])
+                            continue;
+                        ProgramBuild build = live_program_build(VertexInput{ i }, VertShader{ v }, FragShader{ f });
+                        if (reload->vert_reloaded[i][v])
+                        {
+                            build.vert_stage = &reload->stages.vert[i][v];
+                        }
+                        if (reload->frag_reloaded[f])
+                        {
+                            build.frag_stage = &reload->stages.frag[f];
+                        }
+                        reload->builds.push_back(std::move(build));
+                    }
+                }
+            }
+
+            std::string reloaded_files;
+            for (int file = 0; file != shader_file_count; ++file)
+            {
+                if (not files[file])
+                    continue;
+                if (not reloaded_files.empty())
+                {
+                    reloaded_files += ", ";
+                }
+                reloaded_files += filename(shader_file_path(file));
+            }
+            const bool all_files = std::all_of(std::begin(files), std::end(files), [](bool b) { return b; });
+            reload->done_message = all_files ? std::string{ "Shaders reloaded." }
+                                             : std::format("Reloaded {} ({} programs).", reloaded_files, reload->builds.size());
+            reload->feed = feed;
+            // The new programs are built by 'poll_program_builds' over the next iterations of the main loop.
+            shader_reload = std::move(reload);
+        }
+
+        void poll_background_builds()
+        {
+            for (size_t i = 0; i != background_builds.size();)
+            {
+                ProgramBuild* build = &background_builds[i];
+                if (not program_build_complete(*build))
+                {
+                    ++i;
+                    continue;
+                }
+                finish_program_build(build, default_reporter);
+                install_program(build);
+                background_builds.erase(background_builds.begin() + i);
+            }
+        }
+
+        void use_shader_program(VertexInput input, VertShader vert, FragShader frag, const ShaderInputs& inputs)
+        {
+            bool& used = program_used[rep(input)][rep(vert)][rep(frag)];
+            if (not used)
+            {
+                used = true;
+                program_used_changed = true;
+            }
+            const Glew::ProgramHandle program = ensure_program(input, vert, frag);
+            use_program(rep(program));
+            if (rep(program) != 0)
+            {
+                upload_shader_inputs(&program_uniforms[rep(input)][rep(vert)][rep(frag)], inputs);
+            }
+        }
+
+        // Everything needed to replay a recorded draw.
+        struct DrawState
+        {
+            BatchTopology topology = BatchTopology::IndexedQuads;
+            VertShader vert = VertShader::CameraTransform;
+            FragShader frag = FragShader::BasicColor;
+            PipelineState pipeline;
+            ShaderInputs inputs;
+
+            bool operator==(const DrawState&) const = default;
+        };
+
+        // Cheap key for rejecting incompatible commands before comparing the full state.  Ordered (from most to
+        // least significant) by render target, clip, program, texture, and then blending/topology.
+        uint64_t draw_sort_key(const DrawState& state)
+        {
+            const uint64_t program = (uint64_t(rep(vertex_input_for(state.topology))) * count_of<VertShader>
+                                        + rep(state.vert)) * count_of<FragShader>
+                                        + rep(state.frag);
+            return (uint64_t(state.pipeline.framebuffer & 0xFFFF) << 48)
+                    | (uint64_t(state.pipeline.scissor) << 47)
+                    | ((program & 0x7F) << 40)
+                    | (uint64_t(state.pipeline.textures[0] & 0xFFFFFFF) << 12)
+                    | (uint64_t(rep(state.pipeline.blending)) << 4)
+                    | uint64_t(rep(state.topology));
+        }
+
+        struct DrawBounds
+        {
+            Vec2f min;
+            Vec2f max;
+        };
+
+        bool overlaps(const DrawBounds& a, const DrawBounds& b)
+        {
+            return a.min.x < b.max.x and b.min.x < a.max.x
+                and a.min.y < b.max.y and b.min.y < a.max.y;
+        }
+
+        DrawBounds merge_bounds(const DrawBounds& a, const DrawBounds& b)
+        {
+            return { .min = { std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y) },
+                    .max = { std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y) } };
+        }
+
+        // Bounds are in the space of the vertex shader inputs, so they can only be compared when the vertices
+        // are transformed identically.
+        bool same_vertex_space(const DrawState& a, const DrawState& b)
+        {
+            return a.vert == b.vert
+                and a.inputs.resolution == b.inputs.resolution
+                and a.inputs.camera == b.inputs.camera
+                and std::equal(std::begin(a.pipeline.viewport), std::end(a.pipeline.viewport), std::begin(b.pipeline.viewport));
+        }
+
+        struct DrawCommand
+        {
+            uint64_t sort_key;
+            DrawState state;
+            DrawBounds bounds;
+            // Bytes into the 'command_data' of the renderer which recorded it.
+            size_t data_offset;
+            // Resolved from 'data_offset' when the command is gathered for submission.
+            const std::byte* data = nullptr;
+            // Elements of the stream for 'state.topology'.
+            GLsizei count;
+            // The next command merged into the same draw, or -1.
+            int next_merged = -1;
+            // Set for draws of retained geometry, which come from its own buffer instead of 'data'.  These are
+            // never merged.
+            RetainedGeometry::Data* retained = nullptr;
+            int retained_segment = 0;
+        };
+
+        struct MergedDraw
+        {
+            int first;
+            int last;
+            DrawBounds bounds;
+        };
+
+        // The commands of every recording renderer, gathered for submission.
+        std::vector<DrawCommand> recorded_commands;
+        std::vector<MergedDraw> merged_draws;
+
+        // How far back a command may be moved to join an earlier draw.  This bounds the merge to linear time.
+        constexpr int merge_search_window = 64;
+
+        // Retained instances which sample the same textures.
+        struct RetainedSegment
+        {
+            GLsizei first;
+            GLsizei count;
+            // The slots the instances sample, one bit per slot, and the textures which were in them.
+            uint32_t slot_mask;
+            GLuint textures[texture_slot_count];
+            DrawBounds bounds;
+        };
+
+        // Buffers of destroyed retained geometry.  They are deleted on the GL thread at the end of the frame.
+        std::mutex retired_geometry_buffers_lock;
+        std::vector<GLuint> retired_geometry_buffers;
+
+        // Bumped by 'CachedLayer::invalidate_all'.  Layers drawn before the current value are drawn again.
+        uint64_t cached_layer_epoch = 0;
+    } // namespace [anon]
+
+    struct RetainedGeometry::Data
     {
-        apply_viewport(old_viewport);
-        if (old_scissor)
+        // The instances are kept on the CPU as well, since they may be captured on any thread while the buffer can
+        // only be filled on the GL thread (see 'upload_retained_geometry').
+        std::vector<std::byte> instances;
+        GLsizei count = 0;
+        std::vector<RetainedSegment> segments;
+        GLuint buffer = 0;
+        bool upload_pending = false;
+    };
+
+    struct CachedLayer::Data
+    {
+        RenderTexture texture{};
+        bool created = false;
+        bool valid = false;
+        ScreenDimensions size{};
+        uint64_t epoch = 0;
+        // What 'begin_cached_layer' replaced, put back by 'end_cached_layer'.
+        GLint previous_framebuffer = 0;
+        BlendingMode previous_blending = BlendingMode::Default;
+    };
+
+    struct SceneRenderer::Data
+    {
+        FragShader selected_frag_shader = FragShader::BasicColor;
+        VertShader selected_vert_shader = VertShader::CameraTransform;
+
+        Vec2f resolution;
+        float time = 0.f;
+        float dt = 0.f;
+        float custom_float_value1 = 0.f;
+        float custom_float_value2 = 0.f;
+        Vec2f custom_vec2_value1;
+        Vec2f custom_vec2_value2;
+        Vec2f custom_vec2_value3;
+        TextureUnit previous_texture = TextureUnit::Sentinel;
+
+        Camera camera;
+
+        QuadSubmission quad_submission = QuadSubmission::PerVertex;
+
+        VertexArena arena;
+
+        // See 'SceneRenderer::begin_command_recording'.
+        bool recording = false;
+        std::vector<DrawCommand> commands;
+        std::vector<std::byte> command_data;
+        // While recording, the renderer works on a copy of the pipeline state taken when the recording began
+        // and keeps its own counters, so it never touches GL or shared state (see 'renderer_pipeline').
+        PipelineState pipeline;
+        int selected_texture_slot = 0;
+        FrameStats stats;
+
+        // See 'SceneRenderer::begin_retained_geometry'.
+        RetainedGeometry::Data* retaining = nullptr;
+    };
+
+    namespace
+    {
+        // Renderers with recorded commands, in the order they started recording.
+        std::vector<SceneRenderer::Data*> recording_renderers;
+
+        // The pipeline state seen by a renderer.  Changes made while recording stay with the recording and reach
+        // GL when its commands are drawn.
+        PipelineState& renderer_pipeline(SceneRenderer::Data* data)
+        {
+            return data->recording ? data->pipeline : pipeline_state;
+        }
+
+        int& renderer_texture_slot(SceneRenderer::Data* data)
+        {
+            return data->recording ? data->selected_texture_slot : selected_texture_slot;
+        }
+
+        FrameStats& renderer_stats(SceneRenderer::Data* data)
+        {
+            return data->recording ? data->stats : current_frame_stats;
+        }
+
+        void renderer_viewport(SceneRenderer::Data* data, GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            if (data->recording)
+            {
+                store_viewport(&data->pipeline, x, y, width, height);
+                return;
+            }
+            apply_gl_viewport(x, y, width, height);
+        }
+
+        void renderer_scissor(SceneRenderer::Data* data, GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            if (data->recording)
+            {
+                store_scissor(&data->pipeline, x, y, width, height);
+                return;
+            }
+            apply_gl_scissor(x, y, width, height);
+        }
+
+        void renderer_enable_scissor(SceneRenderer::Data* data, bool enable)
+        {
+            if (data->recording)
+            {
+                data->pipeline.scissor = enable;
+                return;
+            }
+            enable_gl_scissor(enable);
+        }
+
+        void renderer_blending(SceneRenderer::Data* data, BlendingMode mode)
+        {
+            if (data->recording)
+            {
+                data->pipeline.blending = mode;
+                return;
+            }
+            apply_gl_blending(mode);
+        }
+
+        void renderer_bind_texture_slot(SceneRenderer::Data* data, int slot, GLuint id)
+        {
+            ++renderer_stats(data).texture_bind_requests;
+            if (data->recording)
+            {
+                data->pipeline.textures[slot] = id;
+                return;
+            }
+            bind_texture_slot(slot, id);
+        }
+
+        // Like 'bind_texture' but recording renderers keep the binding to themselves.
+        void renderer_bind_texture(SceneRenderer::Data* data, GLuint id)
+        {
+            renderer_bind_texture_slot(data, 0, id);
+            renderer_texture_slot(data) = 0;
+        }
+
+        ShaderInputs shader_inputs(const SceneRenderer::Data& data)
+        {
+            return { .resolution = data.resolution,
+                    .time = data.time,
+                    .camera = data.camera,
+                    .custom_float_value1 = data.custom_float_value1,
+                    .custom_float_value2 = data.custom_float_value2,
+                    .custom_vec2_value1 = data.custom_vec2_value1,
+                    .custom_vec2_value2 = data.custom_vec2_value2,
+                    .custom_vec2_value3 = data.custom_vec2_value3,
+                    .previous_texture = data.previous_texture };
+        }
+
+        DrawBounds batch_bounds(BatchTopology topology, const std::byte* data, GLsizei count)
+        {
+            DrawBounds bounds{ .min = { FLT_MAX, FLT_MAX }, .max = { -FLT_MAX, -FLT_MAX } };
+            auto include = [&](float x, float y)
+            {
+                bounds.min = { std::min(bounds.min.x, x), std::min(bounds.min.y, y) };
+                bounds.max = { std::max(bounds.max.x, x), std::max(bounds.max.y, y) };
+            };
+            const GLsizei stride = arena_stride(topology);
+            for (GLsizei i = 0; i != count; ++i)
+            {
+                const std::byte* element = data + i * stride;
+                if (topology == BatchTopology::InstancedQuads)
+                {
+                    Vec4f rect;
+                    std::memcpy(&rect, element + __builtin_offsetof(QuadInstance, rect), sizeof(rect));
+                    include(rect.x, rect.y);
+                    include(rect.x + rect.z, rect.y + rect.a);
+                }
+                else
+                {
+                    // Note: position is the first member of every vertex layout.
+                    Vec2f pos;
+                    std::memcpy(&pos, element, sizeof(pos));
+                    include(pos.x, pos.y);
+                }
+            }
+            return bounds;
+        }
+
+        // Note: This only touches the renderer's own data, so renderers can record on different threads.
+        void record_batch(SceneRenderer::Data* data)
+        {
+            const VertexArena& arena = data->arena;
+            const std::byte* src = arena.bytes.data();
+            DrawCommand command{ .state = { .topology = arena.topology,
+                                            .vert = data->selected_vert_shader,
+                                            .frag = data->selected_frag_shader,
+                                            .pipeline = data->pipeline,
+                                            .inputs = shader_inputs(*data) },
+                                .bounds = batch_bounds(arena.topology, src, arena.count),
+                                .data_offset = data->command_data.size(),
+                                .count = arena.count };
+            command.sort_key = draw_sort_key(command.state);
+            data->command_data.insert(data->command_data.end(), src, src + GLsizeiptr{ arena.count } * arena_stride(arena.topology));
+            data->commands.push_back(command);
+            ++data->stats.draws_recorded;
+        }
+
+        // Moves the pending batch into the retained geometry being captured.  Instances which sample the same
+        // textures as the last segment extend it.
+        void retain_batch(SceneRenderer::Data* data)
+        {
+            const VertexArena& arena = data->arena;
+            // Per-vertex geometry has nowhere to go, the instance buffer is the only one retained.
+            assert(arena.topology == BatchTopology::InstancedQuads);
+            if (arena.topology != BatchTopology::InstancedQuads)
+                return;
+            RetainedGeometry::Data* geometry = data->retaining;
+            const std::byte* src = arena.bytes.data();
+            const PipelineState& pipeline = renderer_pipeline(data);
+            RetainedSegment segment{ .first = geometry->count,
+                                    .count = arena.count,
+                                    .slot_mask = 0,
+                                    .textures = { },
+                                    .bounds = batch_bounds(arena.topology, src, arena.count) };
+            for (GLsizei i = 0; i != arena.count; ++i)
+            {
+                int32_t packed;
+                std::memcpy(&packed, src + i * sizeof(QuadInstance) + __builtin_offsetof(QuadInstance, texture_slot), sizeof(packed));
+                // Note: The slot is the low byte (see 'pack_material').
+                const int slot = (packed & 0xFF) % texture_slot_count;
+                segment.slot_mask |= 1u << slot;
+                segment.textures[slot] = pipeline.textures[slot];
+            }
+            geometry->instances.insert(geometry->instances.end(), src, src + GLsizeiptr{ arena.count } * sizeof(QuadInstance));
+            geometry->count += arena.count;
+            geometry->upload_pending = true;
+            if (not geometry->segments.empty())
+            {
+                RetainedSegment& last = geometry->segments.back();
+                const bool same_textures = std::equal(std::begin(last.textures), std::end(last.textures), std::begin(segment.textures),
+                                                    [&](GLuint a, GLuint b) { return a == 0 or b == 0 or a == b; });
+                if (same_textures)
+                {
+                    last.count += segment.count;
+                    last.slot_mask |= segment.slot_mask;
+                    for (int slot = 0; slot != texture_slot_count; ++slot)
+                    {
+                        if (segment.textures[slot] != 0)
+                        {
+                            last.textures[slot] = segment.textures[slot];
+                        }
+                    }
+                    last.bounds = merge_bounds(last.bounds, segment.bounds);
+                    return;
+                }
+            }
+            geometry->segments.push_back(segment);
+        }
+
+        // Note: This must be called on the GL thread.
+        void upload_retained_geometry(RetainedGeometry::Data* geometry)
         {
-            glEnable(GL_SCISSOR_TEST);
+            if (not geometry->upload_pending)
+                return;
+            if (geometry->buffer == 0)
+            {
+                glGenBuffers(1, &geometry->buffer);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, geometry->buffer);
+            glBufferData(GL_ARRAY_BUFFER, geometry->instances.size(), geometry->instances.data(), GL_STATIC_DRAW);
+            current_frame_stats.retained_upload_bytes += static_cast<int>(geometry->instances.size());
+            geometry->upload_pending = false;
         }
-        else
+
+        // Assumes the program and textures for the segment are in place.
+        void draw_retained_segment(RetainedGeometry::Data* geometry, int index)
         {
-            glDisable(GL_SCISSOR_TEST);
+            const RetainedSegment& segment = geometry->segments[index];
+            upload_retained_geometry(geometry);
+            bind_instance_batch(geometry->buffer, segment.first);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, vertices_per_quad, segment.count);
+            ++current_frame_stats.gl_draws;
+            current_frame_stats.retained_quads += segment.count;
         }
-    }
 
-    ScissorRegion ScissorRegion::basic(const ScreenDimensions& screen)
-    {
-        return { .offset_x = ScissorOffsetX{ },
-                    .offset_y = ScissorOffsetY{ },
-                    .width = screen.width,
-                    .height = screen.height };
-    }
+        void record_retained_segment(SceneRenderer::Data* data, RetainedGeometry::Data* geometry, int index, const ShaderInputs& inputs)
+        {
+            const RetainedSegment& segment = geometry->segments[index];
+            const Vec2f& offset = inputs.geometry_offset;
+            DrawCommand command{ .state = { .topology = BatchTopology::InstancedQuads,
+                                            .vert = data->selected_vert_shader,
+                                            .frag = data->selected_frag_shader,
+                                            .pipeline = data->pipeline,
+                                            .inputs = inputs },
+                                .bounds = { .min = segment.bounds.min + offset, .max = segment.bounds.max + offset },
+                                .data_offset = data->command_data.size(),
+                                .count = segment.count,
+                                .retained = geometry,
+                                .retained_segment = index };
+            command.sort_key = draw_sort_key(command.state);
+            data->commands.push_back(command);
+            ++data->stats.draws_recorded;
+        }
 
-    ScopedScissorRegion::~ScopedScissorRegion()
-    {
-        remove_scissor();
-    }
+        void delete_retired_geometry_buffers()
+        {
+            std::lock_guard lock{ retired_geometry_buffers_lock };
+            if (retired_geometry_buffers.empty())
+                return;
+            if (gl_submission)
+            {
+                glDeleteBuffers(static_cast<GLsizei>(retired_geometry_buffers.size()), retired_geometry_buffers.data());
+            }
+            retired_geometry_buffers.clear();
+        }
 
-    void ScopedScissorRegion::apply_scissor(const ScissorRegion& region)
-    {
-        enable_scissor();
-        glScissor(rep(region.offset_x),
-                    rep(region.offset_y),
-                    rep(region.width),
-                    rep(region.height));
-    }
+        // Adds the counters a renderer keeps while recording (see 'renderer_stats').
+        void add_recording_stats(FrameStats* stats, const FrameStats& recorded)
+        {
+            stats->draws_recorded += recorded.draws_recorded;
+            stats->texture_flushes += recorded.texture_flushes;
+            stats->texture_flushes_avoided += recorded.texture_flushes_avoided;
+            stats->vertices_emitted += recorded.vertices_emitted;
+            stats->flushes += recorded.flushes;
+            stats->shader_switches += recorded.shader_switches;
+            stats->texture_bind_requests += recorded.texture_bind_requests;
+        }
 
-    void ScopedScissorRegion::enable_scissor()
-    {
-        glEnable(GL_SCISSOR_TEST);
-    }
+        // Appends the commands of every recording renderer to 'recorded_commands', one renderer after the other.
+        void gather_recorded_commands()
+        {
+            for (SceneRenderer::Data* data : recording_renderers)
+            {
+                for (DrawCommand& command : data->commands)
+                {
+                    command.data = data->command_data.data() + command.data_offset;
+                    recorded_commands.push_back(command);
+                }
+                add_recording_stats(&current_frame_stats, data->stats);
+                data->stats = { };
+            }
+        }
 
-    void ScopedScissorRegion::remove_scissor()
-    {
-        glDisable(GL_SCISSOR_TEST);
-    }
+        // Commands with identical state are merged into the latest earlier draw as long as nothing drawn in
+        // between overlaps them, which keeps the painter's order of overlapping primitives.
+        void merge_recorded_commands()
+        {
+            merged_draws.clear();
+            for (int i = 0; i != static_cast<int>(recorded_commands.size()); ++i)
+            {
+                DrawCommand& command = recorded_commands[i];
+                bool merged = false;
+                if (command.retained != nullptr)
+                {
+                    merged_draws.push_back({ .first = i, .last = i, .bounds = command.bounds });
+                    continue;
+                }
+                const int window_end = std::max(0, static_cast<int>(merged_draws.size()) - merge_search_window);
+                for (int d = static_cast<int>(merged_draws.size()) - 1; d >= window_end; --d)
+                {
+                    MergedDraw& draw = merged_draws[d];
+                    const DrawCommand& head = recorded_commands[draw.first];
+                    if (head.retained == nullptr and head.sort_key == command.sort_key and head.state == command.state)
+                    {
+                        recorded_commands[draw.last].next_merged = i;
+                        draw.last = i;
+                        draw.bounds = merge_bounds(draw.bounds, command.bounds);
+                        merged = true;
+                        break;
+                    }
+                    // We cannot move this command before a draw it may overlap.
+                    if (not same_vertex_space(head.state, command.state)
+                        or overlaps(draw.bounds, command.bounds))
+                        break;
+                }
+                if (not merged)
+                {
+                    merged_draws.push_back({ .first = i, .last = i, .bounds = command.bounds });
+                }
+            }
+        }
 
-    struct SceneRenderer::Data
-    {
-        FragShader selected_frag_shader = FragShader::BasicColor;
-        VertShader selected_vert_shader = VertShader::CameraTransform;
+        void apply_batch_program(BatchTopology topology, VertShader vert, FragShader frag, const ShaderInputs& inputs)
+        {
+            batch_topology = topology;
+            use_shader_program(vertex_input_for(topology), vert, frag, inputs);
+        }
 
-        UniformsContainer uniforms{};
+        // Only sends what changed since 'last', the state of the draw replayed before this one (if any), and since
+        // 'applied', the pipeline state GL has.
+        void apply_draw_state(const DrawState& state, const DrawState* last, PipelineState* applied)
+        {
+            // 'use_shader_program' skips the uniforms which did not change, but always binds the previous pass
+            // texture again.
+            const bool same_program = last != nullptr
+                                        and last->topology == state.topology
+                                        and last->vert == state.vert
+                                        and last->frag == state.frag
+                                        and last->inputs == state.inputs;
+            if (not same_program)
+            {
+                apply_batch_program(state.topology, state.vert, state.frag, state.inputs);
+            }
+            send_gl_pipeline(state.pipeline, applied);
+        }
 
-        Vec2f resolution;
-        float time = 0.f;
-        float dt = 0.f;
-        float custom_float_value1 = 0.f;
-        float custom_float_value2 = 0.f;
-        Vec2f custom_vec2_value1;
-        Vec2f custom_vec2_value2;
-        Vec2f custom_vec2_value3;
-        TextureUnit previous_texture = TextureUnit::Sentinel;
+        // Copies elements of the stream for 'batch_topology' into it.  Full segments are drawn along the way.
+        void stream_elements(const std::byte* src, GLsizei count)
+        {
+            StreamBuffer* stream = batch_stream();
+            current_frame_stats.elements_streamed += count;
+            GLsizei remaining = count;
+            while (remaining != 0)
+            {
+                // Note: the room left is always a multiple of the primitive size since batches start aligned and
+                // only whole primitives are streamed.
+                const GLsizei n = std::min(remaining, stream->cap - stream->count);
+                std::memcpy(stream->write_base + GLsizeiptr{ stream->count } * stream->stride, src, GLsizeiptr{ n } * stream->stride);
+                stream->count += n;
+                src += GLsizeiptr{ n } * stream->stride;
+                remaining -= n;
+                if (stream->count == stream->cap)
+                {
+                    // The rest of the batch goes into another draw.
+                    if (remaining != 0)
+                    {
+                        ++current_frame_stats.cap_forced_draws;
+                    }
+                    submit_stream_batch();
+                }
+            }
+        }
 
-        Camera camera;
-    };
+        void draw_recorded_commands()
+        {
+            merge_recorded_commands();
+
+            // GL is in line with the shadow state until the first draw.
+            PipelineState applied = pipeline_state;
+            const DrawState* last = nullptr;
+            for (const MergedDraw& draw : merged_draws)
+            {
+                const DrawCommand& head = recorded_commands[draw.first];
+                apply_draw_state(head.state, last, &applied);
+                last = &head.state;
+                ++current_frame_stats.draws_submitted;
+                if (head.retained != nullptr)
+                {
+                    draw_retained_segment(head.retained, head.retained_segment);
+                    continue;
+                }
+                for (int i = draw.first; i != -1; i = recorded_commands[i].next_merged)
+                {
+                    stream_elements(recorded_commands[i].data, recorded_commands[i].count);
+                }
+                submit_stream_batch();
+            }
+
+            // Put GL back in line with the shadow state.
+            send_gl_pipeline(pipeline_state, &applied);
+
+            recorded_commands.clear();
+        }
+
+        // Stands in for 'draw_recorded_commands' without GL.  The commands are still merged so that all of the CPU
+        // work is done.
+        void drop_recorded_commands()
+        {
+            merge_recorded_commands();
+            // Without GL 'send_gl_pipeline' only counts the texture binds a replay would make.
+            PipelineState applied = pipeline_state;
+            for (const MergedDraw& draw : merged_draws)
+            {
+                ++current_frame_stats.draws_submitted;
+                const DrawCommand& head = recorded_commands[draw.first];
+                send_gl_pipeline(head.state.pipeline, &applied);
+                if (head.retained != nullptr)
+                {
+                    current_frame_stats.retained_quads += head.count;
+                    continue;
+                }
+                for (int i = draw.first; i != -1; i = recorded_commands[i].next_merged)
+                {
+                    current_frame_stats.elements_streamed += recorded_commands[i].count;
+                }
+            }
+            send_gl_pipeline(pipeline_state, &applied);
+            recorded_commands.clear();
+        }
+
+        // Draws everything recorded so far, in order.  Anything which changes GL state the recorded commands did not
+        // capture (framebuffer bindings, clears, the damage clip, texture uploads and deletions) calls this first so
+        // the commands land in the state they were recorded against.
+        // Note: Renderers recording on other threads must have ended their recording before anything calls this.
+        void submit_recorded_commands()
+        {
+            CPU_PROFILE_SCOPE("Submit recorded commands");
+            gather_recorded_commands();
+            if (not recorded_commands.empty())
+            {
+                if (gl_submission)
+                {
+                    draw_recorded_commands();
+                }
+                else
+                {
+                    drop_recorded_commands();
+                }
+            }
+            for (SceneRenderer::Data* data : recording_renderers)
+            {
+                data->commands.clear();
+                data->command_data.clear();
+            }
+            // Renderers which ended their recording are done once their commands are drawn.
+            std::erase_if(recording_renderers, [](const SceneRenderer::Data* data) { return not data->recording; });
+        }
+
+        // Framebuffers are (re)allocated here, when they are next used, rather than when the screen is resized.  A
+        // burst of resize events then costs a single allocation, and only for the framebuffers still in use.
+        void ensure_framebuffer_storage(FramebufferData* data, int downscale)
+        {
+            const ScreenDimensions extent = { .width = Width{ rep(render_target_extent.width) / downscale },
+                                                .height = Height{ rep(render_target_extent.height) / downscale } };
+            if (rep(data->id) != 0 and same_size(data->allocated, extent))
+                return;
+            // Draws sampling the old attachments must land first.
+            submit_recorded_commands();
+            if (rep(data->id) == 0)
+            {
+                glCreateFramebuffers(1, reinterpret_cast<GLuint*>(&data->id));
+            }
+            else
+            {
+                delete_textures(data->attachments);
+                delete_texture(data->depth_attachment);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, rep(data->id));
+            setup_framebuffer_texture_attachments(data, extent);
+            data->allocated = extent;
+            ++current_frame_stats.render_target_allocations;
+            // Back to whichever framebuffer was bound.
+            glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(pipeline_state.framebuffer));
+        }
+
+        FramebufferData* ensure_framebuffer(Framebuffer fb)
+        {
+            if (PooledFramebuffer* entry = pooled_framebuffer(fb))
+            {
+                ensure_framebuffer_storage(&entry->data, entry->downscale);
+                return &entry->data;
+            }
+            FramebufferData* data = &framebuffer_collection[rep(fb)];
+            ensure_framebuffer_storage(data, 1);
+            return data;
+        }
+    } // namespace [anon]
 
     // Mostly rendering stuff...
     namespace
     {
-        void dummy_cull(SceneRenderer*) { }
-        void cull_vertices(SceneRenderer* renderer)
+        // This function is extremely hot.  The arena grows instead of flushing when it fills up, so the only
+        // branch is the (rarely taken) growth in 'push_arena_element'.
+        void render_vertex(VertexArena* arena, const RenderVertex& target)
         {
-            renderer->flush();
+            vertex_writer(push_arena_element(arena, vertex_stream.stride), target);
         }
 
-        using Culler = void(*)(SceneRenderer*);
+        void render_instance(VertexArena* arena, const QuadInstance& target)
+        {
+            std::memcpy(push_arena_element(arena, sizeof(QuadInstance)), &target, sizeof(target));
+        }
 
-        Culler cullers[] = {
-            cull_vertices,
-            dummy_cull
-        };
+        void use_batch_topology(SceneRenderer* renderer, VertexArena* arena, BatchTopology topology)
+        {
+            if (arena->topology == topology)
+                return;
+            renderer->flush();
+            // Note: The program for the kind of vertex input is picked when the batch is drawn.
+            arena->topology = topology;
+        }
+
+        // Returns the slot holding 'id', binding it to a free slot first if needed.  Slot 0 is left to
+        // 'bind_texture'.
+        int acquire_texture_slot(SceneRenderer* renderer, SceneRenderer::Data* data, GLuint id)
+        {
+            PipelineState& pipeline = renderer_pipeline(data);
+            int free_slot = -1;
+            for (int slot = 1; slot != texture_slot_count; ++slot)
+            {
+                if (pipeline.textures[slot] == id)
+                    return slot;
+                if (free_slot == -1 and pipeline.textures[slot] == 0)
+                {
+                    free_slot = slot;
+                }
+            }
+            if (free_slot == -1)
+            {
+                // Every slot may be sampled by the pending batch, so it has to land before one is reused.
+                if (data->arena.count != 0)
+                {
+                    ++renderer_stats(data).texture_flushes;
+                }
+                renderer->flush();
+                std::fill(std::begin(pipeline.textures) + 1, std::end(pipeline.textures), 0u);
+                free_slot = 1;
+            }
+            renderer_bind_texture_slot(data, free_slot, id);
+            return free_slot;
+        }
 
-        void render_vertex(SceneRenderer* renderer, const RenderVertex& target)
+        void select_texture_id(SceneRenderer* renderer, SceneRenderer::Data* data, GLuint id)
         {
-            assert(vertices_flush_count < vertex_cap);
-            vertices[vertices_flush_count] = target;
-            ++vertices_flush_count;
-            // This function is extremely hot, so we need to reduce the number of branches as
-            // much as humanly possible.  Below we implement a branchless dispatch table to
-            // identify when the vertex count grows large enough to cull.
-            // Note: since vertices_flush_count will always be at least '1' at this point, we
-            // will only make the following boolean expression 'true' exactly one time, when
-            // vertices_flush_count == vertex_cap.
-            cullers[bool(vertices_flush_count % vertex_cap)](renderer);
+            int& selected_slot = renderer_texture_slot(data);
+            if (renderer_pipeline(data).textures[selected_slot] == id)
+                return;
+            if (data->quad_submission == QuadSubmission::PerVertex)
+            {
+                // Vertices have no room for a slot, so they always sample slot 0.
+                if (data->arena.count != 0)
+                {
+                    ++renderer_stats(data).texture_flushes;
+                }
+                renderer->flush();
+                renderer_bind_texture_slot(data, 0, id);
+                selected_slot = 0;
+                return;
+            }
+            const bool pending = data->arena.count != 0;
+            selected_slot = acquire_texture_slot(renderer, data, id);
+            // A pending batch which survived the change would have been flushed without slots.
+            if (pending and data->arena.count != 0)
+            {
+                ++renderer_stats(data).texture_flushes_avoided;
+            }
         }
 
         // 2
         // | \ 
         // 0 - 1
-        void render_triangle(SceneRenderer* renderer,
+        void render_triangle(SceneRenderer* renderer, VertexArena* arena,
                             const Vec2f& p0, const Vec2f& p1, const Vec2f& p2,
                             const Vec4f& c0, const Vec4f& c1, const Vec4f& c2,
                             const Vec2f& uv0, const Vec2f& uv1, const Vec2f& uv2)
         {
-            render_vertex(renderer, { .pos = p0, .color = c0, .uv = uv0 });
-            render_vertex(renderer, { .pos = p1, .color = c1, .uv = uv1 });
-            render_vertex(renderer, { .pos = p2, .color = c2, .uv = uv2 });
+            use_batch_topology(renderer, arena, BatchTopology::Triangles);
+            render_vertex(arena, { .pos = p0, .color = c0, .uv = uv0 });
+            render_vertex(arena, { .pos = p1, .color = c1, .uv = uv1 });
+            render_vertex(arena, { .pos = p2, .color = c2, .uv = uv2 });
         }
 
         // 2 - 3
         // | \ |
         // 0 - 1
-        void render_quad(SceneRenderer* renderer,
+        void render_quad(SceneRenderer* renderer, VertexArena* arena,
                         const Vec2f& p0, const Vec2f& p1, const Vec2f& p2, const Vec2f& p3,
                         const Vec4f& c0, const Vec4f& c1, const Vec4f& c2, const Vec4f& c3,
                         const Vec2f& uv0, const Vec2f& uv1, const Vec2f& uv2, const Vec2f& uv3)
         {
-            render_triangle(renderer, p0, p1, p2, c0, c1, c2, uv0, uv1, uv2);
-            render_triangle(renderer, p1, p2, p3, c1, c2, c3, uv1, uv2, uv3);
+            use_batch_topology(renderer, arena, BatchTopology::IndexedQuads);
+            render_vertex(arena, { .pos = p0, .color = c0, .uv = uv0 });
+            render_vertex(arena, { .pos = p1, .color = c1, .uv = uv1 });
+            render_vertex(arena, { .pos = p2, .color = c2, .uv = uv2 });
+            render_vertex(arena, { .pos = p3, .color = c3, .uv = uv3 });
         }
-    } // namespace [anon]
 
-    SceneRenderer::SceneRenderer():
-        data{ new Data } { }
+        // Same layout as 'render_quad' where 'pos' and 'uv_pos' correspond to corner 0.
+        void render_instanced_quad(SceneRenderer* renderer, VertexArena* arena,
+                                    const Vec2f& pos, const Vec2f& size,
+                                    const Vec2f& uv_pos, const Vec2f& uv_size,
+                                    const Vec4f& color,
+                                    int texture_slot)
+        {
+            use_batch_topology(renderer, arena, BatchTopology::InstancedQuads);
+            const Vec2f uv_last = uv_pos + uv_size;
+            render_instance(arena,
+                { .rect = { { pos.x, pos.y, size.x, size.y } },
+                .uv_rect = { { { pack_snorm16(uv_pos.x), pack_snorm16(uv_pos.y) },
+                                { pack_snorm16(uv_last.x), pack_snorm16(uv_last.y) } } },
+                .color = { { pack_unorm8(color.x), pack_unorm8(color.y), pack_unorm8(color.z), pack_unorm8(color.a) } },
+                .texture_slot = { texture_slot } });
+        }
 
-    SceneRenderer::~SceneRenderer() = default;
+        // Packs a 'UIMaterial' in with the texture slot: the slot is the low byte, followed by the material and then
+        // the corner radius in quarter units.
+        int32_t pack_material(int texture_slot, UIMaterial material, float corner_radius = 0.f)
+        {
+            const auto radius = static_cast<int32_t>(std::clamp(corner_radius * 4.f + 0.5f, 0.f, 32767.f));
+            return texture_slot | (rep(material) << 8) | (radius << 16);
+        }
 
-    bool SceneRenderer::init(const ScreenDimensions& screen)
-    {
-        init_vertex_buffer();
-        for (auto& framebuf : framebuffer_collection)
+        void render_material_image(SceneRenderer* renderer, SceneRenderer::Data* data,
+                                    UIMaterial material,
+                                    const Vec2f& pos, const Vec2f& size,
+                                    const Vec2f& uv_pos, const Vec2f& uv_size,
+                                    const Vec4f& color)
+        {
+            if (data->quad_submission == QuadSubmission::PerVertex)
+            {
+                renderer->render_image(pos, size, uv_pos, uv_size, color);
+                return;
+            }
+            render_instanced_quad(renderer, &data->arena, pos, size, uv_pos, uv_size, color,
+                                    pack_material(renderer_texture_slot(data), material));
+        }
+
+        // Lines are expanded this far past their edges so 'FragShader::Line' has room to fade them out.
+        constexpr float line_feather = 0.5f;
+        // Joins sharper than this (as a multiple of the half thickness) are cut short.
+        constexpr float line_miter_limit = 4.f;
+
+        Vec2f segment_normal(const Vec2f& a, const Vec2f& b)
         {
-            init_framebuffer(&framebuf, screen);
+            const Vec2f d = b - a;
+            const float len = std::sqrt(d.mag2());
+            if (len < 1e-4f)
+                return { };
+            return { -d.y / len, d.x / len };
         }
 
-        for (int v = 0; v != count_of<VertShader>; ++v)
+        // The offset from a joint to the edge of the line on the side of 'n0' and 'n1', the normals of the
+        // segments meeting there.
+        Vec2f join_offset(const Vec2f& n0, const Vec2f& n1, float half_thickness)
         {
-            auto vert_handle = compile_shader_file(builtin_vert_shader_path(VertShader{ v }), Glew::ShaderType::Vertex, default_reporter);
-            if (not vert_handle)
-                return false;
-            for (int f = 0; f != count_of<FragShader>;++f)
+            // Degenerate segments have no normal, so the other segment decides.
+            if (n0 == Vec2f{ })
+                return n1 * half_thickness;
+            if (n1 == Vec2f{ })
+                return n0 * half_thickness;
+            Vec2f miter = n0 + n1;
+            const float len = std::sqrt(miter.mag2());
+            // The line turns back onto itself.
+            if (len < 1e-4f)
+                return n1 * half_thickness;
+            miter = miter / len;
+            const float cos_half_angle = miter.x * n0.x + miter.y * n0.y;
+            return miter * (half_thickness / std::max(cos_half_angle, 1.f / line_miter_limit));
+        }
+
+        // Each segment is a quad whose ends meet the neighboring segments at a mitered join.  The UV runs from -1
+        // to 1 across the line so the fragment shader can tell how far a fragment is from its edge.
+        void render_polyline(SceneRenderer* renderer, VertexArena* arena,
+                            std::span<const Vec2f> points, float thickness, const Vec4f& color)
+        {
+            if (points.size() < 2)
+                return;
+            const float half_thickness = thickness / 2.f + line_feather;
+            Vec2f normal = segment_normal(points[0], points[1]);
+            Vec2f start_offset = normal * half_thickness;
+            for (size_t i = 0; i + 1 != points.size(); ++i)
             {
-                auto frag_handle = compile_shader_file(builtin_frag_shader_path(FragShader{ f }), Glew::ShaderType::Fragment, default_reporter);
-                if (not frag_handle)
-                    return false;
-                shader_programs[v][f] = Glew::attach_and_create_program(
-                    Glew::VertexShaderHandle{ vert_handle.handle() },
-                    Glew::FragmentShaderHandle{ frag_handle.handle() });
-                if (!Glew::link_program(shader_programs[v][f].handle(), default_reporter))
-                    return false;
+                Vec2f end_offset = normal * half_thickness;
+                Vec2f next_normal = normal;
+                if (i + 2 != points.size())
+                {
+                    next_normal = segment_normal(points[i + 1], points[i + 2]);
+                    end_offset = join_offset(normal, next_normal, half_thickness);
+                }
+                const Vec2f& a = points[i];
+                const Vec2f& b = points[i + 1];
+                render_quad(renderer, arena,
+                    a - start_offset,
+                    b - end_offset,
+                    a + start_offset,
+                    b + end_offset,
+                    // Color
+                    color,
+                    color,
+                    color,
+                    color,
+                    // Distance across the line
+                    Vec2f(-1.f, -1.f),
+                    Vec2f(1.f, -1.f),
+                    Vec2f(-1.f, 1.f),
+                    Vec2f(1.f, 1.f));
+                normal = next_normal;
+                start_offset = end_offset;
             }
         }
+    } // namespace [anon]
+
+    ScopedRenderViewport::ScopedRenderViewport(RenderViewport old, SceneRenderer* renderer):
+        current{ old }, old_viewport{ old }, renderer{ renderer } { }
+
+    ScopedRenderViewport::~ScopedRenderViewport()
+    {
+        reset_viewport();
+    }
+
+    void ScopedRenderViewport::apply_viewport(RenderViewport viewport)
+    {
+        // This ensures that pixels snap to an even number.
+        current = viewport;
+        float w = static_cast<float>(current.width);
+        if ((rep(current.width) & 1) == 1)
+        {
+            w += 1.0;
+            current.width = extend(current.width);
+        }
+        float h = static_cast<float>(current.height);
+        if ((rep(current.height) & 1) == 1)
+        {
+            h += 1.0;
+            current.height = extend(current.height);
+        }
+        renderer_viewport(renderer->data.get(),
+                    rep(current.offset_x),
+                    rep(current.offset_y),
+                    rep(current.width),
+                    rep(current.height));
+        renderer->resolution(Vec2f(w, h));
+    }
+
+    void ScopedRenderViewport::reset_viewport()
+    {
+        apply_viewport(old_viewport);
+    }
+
+    ScopedRenderViewport ScopedRenderViewport::sub() const
+    {
+        return { current, renderer };
+    }
+
+    ScopedRenderViewportScissor::ScopedRenderViewportScissor(RenderViewport old, SceneRenderer* renderer):
+        current{ old }, old_viewport{ old }, old_scissor{ renderer_pipeline(renderer->data.get()).scissor }, renderer{ renderer } { }
+
+    ScopedRenderViewportScissor::~ScopedRenderViewportScissor()
+    {
+        reset_viewport();
+    }
+
+    void ScopedRenderViewportScissor::apply_viewport(RenderViewport viewport)
+    {
+        current = viewport;
+        SceneRenderer::Data* data = renderer->data.get();
+        renderer_enable_scissor(data, true);
+        renderer_viewport(data,
+                    rep(current.offset_x),
+                    rep(current.offset_y),
+                    // We retain the resolution of the original viewport.
+                    rep(old_viewport.width),
+                    rep(old_viewport.height));
+        // Apply scissor.
+        renderer_scissor(data,
+                    rep(current.offset_x),
+                    rep(current.offset_y),
+                    rep(current.width),
+                    rep(current.height));
+    }
+
+    void ScopedRenderViewportScissor::reset_viewport()
+    {
+        apply_viewport(old_viewport);
+        renderer_enable_scissor(renderer->data.get(), old_scissor);
+    }
+
+    SceneRenderer::SceneRenderer():
+        data{ new Data } { }
+
+    SceneRenderer::~SceneRenderer()
+    {
+        // Whatever was recorded but not submitted is dropped along with the renderer.
+        std::erase(recording_renderers, data.get());
+    }
+
+    void SceneRenderer::init_without_gl(VertexLayout layout)
+    {
+        gl_submission = false;
+        const VertexLayoutFormat& format = vertex_layout_formats[rep(layout)];
+        vertex_writer = format.writer;
+        // Only the strides are needed to build geometry in the arenas.
+        vertex_stream.stride = format.stride;
+        instance_stream.stride = sizeof(QuadInstance);
+    }
+
+    bool SceneRenderer::init(const ScreenDimensions& screen, VertexLayout layout, std::string_view cache_dir, bool parallel_compile)
+    {
+        init_vertex_buffer(layout);
+        init_frame_inputs_buffer();
+        // The framebuffers are allocated on first use.
+        screen_update(screen);
+        init_program_cache(cache_dir);
+        init_parallel_shader_compile(parallel_compile);
+        program_build_stats.parallel_compile = parallel_shader_compile;
+        // Programs are built in the background or the first time they are used (see 'ensure_program'), so only
+        // the sources are read here.
+        ShaderFileFlags all_files;
+        std::fill(std::begin(all_files), std::end(all_files), true);
+        if (not read_shader_stages("", all_files, &shader_stages, default_reporter))
+            return false;
+        submit_background_builds(load_used_programs());
         return true;
     }
 
     void SceneRenderer::set_shader(FragShader shader)
     {
-        data->selected_frag_shader = shader;
-        glUseProgram(rep(shader_programs[rep(data->selected_vert_shader)][rep(shader)].handle()));
-        populate_uniform_locations(shader_programs[rep(data->selected_vert_shader)][rep(shader)].handle(), &data->uniforms);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::Resolution)]), data->resolution.x, data->resolution.y);
-        glUniform1f(rep(data->uniforms[rep(ShaderUniformLocation::Time)]), data->time);
-        glUniform1f(rep(data->uniforms[rep(ShaderUniformLocation::CameraCoordFactor)]), Constants::shader_scale_factor);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::CameraPos)]), data->camera.pos.x, data->camera.pos.y);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::CameraScale)]), data->camera.scale.x, data->camera.scale.y);
-        glUniform1f(rep(data->uniforms[rep(ShaderUniformLocation::CustomFloatValue1)]), data->custom_float_value1);
-        glUniform1f(rep(data->uniforms[rep(ShaderUniformLocation::CustomFloatValue2)]), data->custom_float_value2);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::CustomVec2Value1)]), data->custom_vec2_value1.x, data->custom_vec2_value1.y);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::CustomVec2Value2)]), data->custom_vec2_value2.x, data->custom_vec2_value2.y);
-        glUniform2f(rep(data->uniforms[rep(ShaderUniformLocation::CustomVec2Value3)]), data->custom_vec2_value3.x, data->custom_vec2_value3.y);
-        if (data->previous_texture != TextureUnit::Sentinel)
-        {
-            // Now we can bind it to texture unit 1.
-            glActiveTexture(GL_TEXTURE1);
-            bind_texture(rep(data->previous_texture));
-            // We also keep texture unit 0 as the active texture unit for future binding since the bind above
-            // is a 1-off thing.
-            glActiveTexture(GL_TEXTURE0);
-            // Set the uniform properly.
-            // NOTE: The second parameter is NOT the texture id but rather the unit to which the texture is
-            // associated.  In the case of this texture we used GL_TEXTURE1 so the unit is 1.
-            glUniform1i(rep(data->uniforms[rep(ShaderUniformLocation::PreviousPassTexture)]), 1);
+        if (shader != data->selected_frag_shader)
+        {
+            ++renderer_stats(data.get()).shader_switches;
         }
+        data->selected_frag_shader = shader;
+        // Recorded commands capture the selection and inputs when they are flushed.
+        if (data->recording or not gl_submission)
+            return;
+        use_shader_program(vertex_input_for(data->arena.topology), data->selected_vert_shader, shader, shader_inputs(*data));
     }
 
     void SceneRenderer::set_shader(VertShader shader)
     {
         // Since the vertex shader always requires a fragment shader, we won't bother setting the uniform locations
         // just yet.
+        if (shader != data->selected_vert_shader)
+        {
+            ++renderer_stats(data.get()).shader_switches;
+        }
         data->selected_vert_shader = shader;
     }
 
+    FragShader SceneRenderer::selected_frag_shader() const
+    {
+        return data->selected_frag_shader;
+    }
+
+    void SceneRenderer::quad_submission(QuadSubmission mode)
+    {
+        data->quad_submission = mode;
+    }
+
+    bool SceneRenderer::ui_materials() const
+    {
+        return data->quad_submission == QuadSubmission::Instanced;
+    }
+
+    void SceneRenderer::select_texture(BasicTexture tex)
+    {
+        select_texture_id(this, data.get(), rep(tex));
+    }
+
+    void SceneRenderer::select_texture(GlyphTexture tex)
+    {
+        select_texture_id(this, data.get(), rep(tex));
+    }
+
     ScopedRenderViewport SceneRenderer::create_viewport(const ScreenDimensions& screen)
     {
         // Perhaps we should discard the 'screen' argument and simply use glGet to get these properties, but most
@@ -862,49 +3319,71 @@ namespace Render
     {
         // Perhaps we should discard the 'screen' argument and simply use glGet to get these properties, but most
         // of the time we know them so we can save the query time.
-        return { RenderViewport::basic(screen) };
+        return { RenderViewport::basic(screen), this };
     }
 
     ScopedRenderViewportScissor SceneRenderer::create_scissor_viewport(const RenderViewport& viewport)
     {
         // Still possibly use glGet to do this...
-        return { viewport };
+        return { viewport, this };
     }
 
     void SceneRenderer::populate_buffer()
     {
-        glBufferSubData(GL_ARRAY_BUFFER,
-                        0,
-                        vertices_flush_count * sizeof(RenderVertex),
-                        vertices);
+        const VertexArena& arena = data->arena;
+        apply_batch_program(arena.topology,
+                            data->selected_vert_shader,
+                            data->selected_frag_shader,
+                            shader_inputs(*data));
+        stream_elements(arena.bytes.data(), arena.count);
     }
 
     void SceneRenderer::draw()
     {
-        glDrawArrays(GL_TRIANGLES, 0, vertices_flush_count);
+        submit_stream_batch();
     }
 
     void SceneRenderer::flush()
     {
-        populate_buffer();
-        draw();
-        vertices_flush_count = 0;
-#ifndef NDEBUG
-        current_renderer = nullptr;
-#endif // NDEBUG
+        if (data->arena.count == 0)
+            return;
+        CPU_PROFILE_SCOPE("SceneRenderer::flush");
+        FrameStats& stats = renderer_stats(data.get());
+        ++stats.flushes;
+        stats.vertices_emitted += data->arena.topology == BatchTopology::InstancedQuads ? data->arena.count * vertices_per_quad
+                                                                                        : data->arena.count;
+        if (data->retaining != nullptr)
+        {
+            retain_batch(data.get());
+        }
+        else if (data->recording)
+        {
+            record_batch(data.get());
+        }
+        else if (gl_submission)
+        {
+            populate_buffer();
+            draw();
+        }
+        else
+        {
+            current_frame_stats.elements_streamed += data->arena.count;
+        }
+        data->arena.count = 0;
     }
 
     void SceneRenderer::solid_rect(const Vec2f& top_left, const Vec2f& size, const Vec4f& color)
     {
-        assert(current_renderer == nullptr or current_renderer == this);
-#ifndef NDEBUG
-        current_renderer = this;
-#endif // NDEBUG
         constexpr Vec2f top_left_uv{-1.f, 1.f};
         constexpr Vec2f bottom_left_uv{-1.f, -1.f};
         constexpr Vec2f top_right_uv{1.f, 1.f};
         constexpr Vec2f bottom_right_uv{1.f, -1.f};
-        render_quad(this,
+        if (data->quad_submission == QuadSubmission::Instanced)
+        {
+            render_instanced_quad(this, &data->arena, top_left, size, top_left_uv, bottom_right_uv - top_left_uv, color, renderer_texture_slot(data.get()));
+            return;
+        }
+        render_quad(this, &data->arena,
             top_left,
             top_left + Vec2f(size.x, 0),
             top_left + Vec2f(0, size.y),
@@ -923,11 +3402,12 @@ namespace Render
 
     void SceneRenderer::render_image(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color)
     {
-        assert(current_renderer == nullptr or current_renderer == this);
-#ifndef NDEBUG
-        current_renderer = this;
-#endif // NDEBUG
-        render_quad(this,
+        if (data->quad_submission == QuadSubmission::Instanced)
+        {
+            render_instanced_quad(this, &data->arena, pos, size, uv_pos, uv_size, color, renderer_texture_slot(data.get()));
+            return;
+        }
+        render_quad(this, &data->arena,
             pos,
             pos + Vec2f(size.x, 0),
             pos + Vec2f(0, size.y),
@@ -944,6 +3424,38 @@ namespace Render
             uv_pos + uv_size);
     }
 
+    void SceneRenderer::ui_rounded_rect(const Vec2f& top_left, const Vec2f& size, float radius, const Vec4f& color)
+    {
+        if (data->quad_submission == QuadSubmission::PerVertex)
+        {
+            solid_rect(top_left, size, color);
+            return;
+        }
+        // The UVs run from -1 to 1 across the rect so the shader can find its edges.
+        render_instanced_quad(this, &data->arena, top_left, size, Vec2f{ -1.f, 1.f }, Vec2f{ 2.f, -2.f }, color,
+                                pack_material(renderer_texture_slot(data.get()), UIMaterial::RoundedRect, radius));
+    }
+
+    void SceneRenderer::ui_circle(const Vec2f& center, float radius, const Vec4f& color)
+    {
+        ui_rounded_rect(center - radius, Vec2f{ radius * 2.f }, radius, color);
+    }
+
+    void SceneRenderer::ui_glyph(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color)
+    {
+        render_material_image(this, data.get(), UIMaterial::Glyph, pos, size, uv_pos, uv_size, color);
+    }
+
+    void SceneRenderer::ui_image(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color)
+    {
+        render_material_image(this, data.get(), UIMaterial::Image, pos, size, uv_pos, uv_size, color);
+    }
+
+    void SceneRenderer::ui_icon(const Vec2f& pos, const Vec2f& size, const Vec2f& uv_pos, const Vec2f& uv_size, const Vec4f& color)
+    {
+        render_material_image(this, data.get(), UIMaterial::Icon, pos, size, uv_pos, uv_size, color);
+    }
+
     void SceneRenderer::strike_rect(const Vec2f& top_left, const Vec2f& size, float thickness, const Vec4f& color)
     {
         auto strike_pos = top_left;
@@ -990,18 +3502,23 @@ namespace Render
         solid_rect(top_left, size, color);
     }
 
+    void SceneRenderer::solid_triangle(const Vec2f& p0, const Vec2f& p1, const Vec2f& p2, const Vec4f& color)
+    {
+        render_triangle(this, &data->arena,
+            p0, p1, p2,
+            color, color, color,
+            Vec2f{}, Vec2f{}, Vec2f{});
+    }
+
     void SceneRenderer::line(const Vec2f& a, const Vec2f& b, float thickness, const Vec4f& color)
     {
-        render_vertex(this, { .pos = a, .color = color, .uv = {} });
-        render_vertex(this, { .pos = b, .color = color, .uv = {} });
-        populate_buffer();
-        glEnable(GL_LINE_SMOOTH);
-        glLineWidth(thickness);
-        glDrawArrays(GL_LINE_STRIP, 0, vertices_flush_count);
-        vertices_flush_count = 0;
-#ifndef NDEBUG
-        current_renderer = nullptr;
-#endif // NDEBUG
+        const Vec2f points[] = { a, b };
+        render_polyline(this, &data->arena, points, thickness, color);
+    }
+
+    void SceneRenderer::polyline(std::span<const Vec2f> points, float thickness, const Vec4f& color)
+    {
+        render_polyline(this, &data->arena, points, thickness, color);
     }
 
     const Camera& SceneRenderer::camera() const
@@ -1068,66 +3585,396 @@ namespace Render
 
     void SceneRenderer::reload_shaders(std::string_view asset_core_path, Feed::MessageFeed* feed)
     {
-        auto reporter = [&](const std::string& s)
+        ShaderFileFlags all_files;
+        std::fill(std::begin(all_files), std::end(all_files), true);
+        start_shader_reload(asset_core_path, all_files, feed);
+    }
+
+    void SceneRenderer::watch_shaders(std::string_view asset_core_path, Feed::MessageFeed* feed)
+    {
+        const Ticks now = ticks_since_app_start();
+        ShaderWatch* watch = &shader_watch;
+        if (watch->asset_core_path != asset_core_path)
         {
-            feed->queue_error(s);
-        };
-        // Populate the new programs into a temporary container that we can move from later. If
-        // shader compilation or linking fails, we leave this function before the new programs are
-        // populated.
-        ShaderProgramContainer new_programs;
-        for (int v = 0; v != count_of<VertShader>; ++v)
-        {
-            auto shader_path = combine_paths(asset_core_path.data(), builtin_vert_shader_path(VertShader{ v }));
-            auto vert_handle = compile_shader_file(shader_path.c_str(), Glew::ShaderType::Vertex, reporter);
-            if (not vert_handle)
-                return;
-            for (int f = 0; f != count_of<FragShader>;++f)
+            // Changes are seen relative to whatever is on disk right now.
+            *watch = { .asset_core_path = std::string{ asset_core_path }, .last_poll = now };
+            for (int file = 0; file != shader_file_count; ++file)
             {
-                shader_path = combine_paths(asset_core_path.data(), builtin_frag_shader_path(FragShader{ f }));
-                auto frag_handle = compile_shader_file(shader_path.c_str(), Glew::ShaderType::Fragment, reporter);
-                if (not frag_handle)
-                    return;
-                new_programs[v][f] = Glew::attach_and_create_program(
-                    Glew::VertexShaderHandle{ vert_handle.handle() },
-                    Glew::FragmentShaderHandle{ frag_handle.handle() });
-                if (!Glew::link_program(new_programs[v][f].handle(), reporter))
-                    return;
+                watch->write_times[file] = file_write_time(combine_paths(asset_core_path, shader_file_path(file)));
+            }
+            return;
+        }
+        if (rep(now) - rep(watch->last_poll) < shader_watch_poll_ms)
+            return;
+        watch->last_poll = now;
+
+        bool changed = false;
+        for (int file = 0; file != shader_file_count; ++file)
+        {
+            const uint64_t write_time = file_write_time(combine_paths(asset_core_path, shader_file_path(file)));
+            if (write_time != watch->write_times[file])
+            {
+                watch->write_times[file] = write_time;
+                watch->changed[file] = true;
+                watch->last_change = now;
+            }
+            changed = changed or watch->changed[file];
+        }
+        // A reload still building goes first so that the two cannot finish out of order.
+        if (not changed
+            or rep(now) - rep(watch->last_change) < shader_watch_debounce_ms
+            or shader_reload != nullptr)
+            return;
+        start_shader_reload(asset_core_path, watch->changed, feed);
+        std::fill(std::begin(watch->changed), std::end(watch->changed), false);
+    }
+
+    void SceneRenderer::build_all_programs()
+    {
+        if (not gl_submission)
+            return;
+        // Note: These are not marked as used (see 'save_used_programs'), only drawing does that.
+        for (int i = 0; i != count_of<VertexInput>; ++i)
+        {
+            for (int v = 0; v != count_of<VertShader>; ++v)
+            {
+                for (int f = 0; f != count_of<FragShader>; ++f)
+                {
+                    ensure_program(VertexInput{ i }, VertShader{ v }, FragShader{ f });
+                }
+            }
+        }
+    }
+
+    bool SceneRenderer::poll_program_builds()
+    {
+        if (not gl_submission)
+            return false;
+        poll_background_builds();
+        if (program_used_changed)
+        {
+            save_used_programs();
+        }
+        return poll_shader_reload();
+    }
+
+    void SceneRenderer::begin_command_recording()
+    {
+        assert(not data->recording);
+        // Anything pending belongs before the recording.
+        flush();
+        sync_pipeline_state();
+        data->pipeline = pipeline_state;
+        data->selected_texture_slot = selected_texture_slot;
+        data->recording = true;
+        // Note: A renderer whose earlier recording was not submitted yet keeps its place.
+        if (std::find(recording_renderers.begin(), recording_renderers.end(), data.get()) == recording_renderers.end())
+        {
+            recording_renderers.push_back(data.get());
+        }
+    }
+
+    void SceneRenderer::end_command_recording()
+    {
+        assert(data->recording);
+        flush();
+        data->recording = false;
+        // The commands are submitted together once the last renderer is done.
+        const bool still_recording = std::any_of(recording_renderers.begin(),
+                                                recording_renderers.end(),
+                                                [](const Data* d) { return d->recording; });
+        if (still_recording)
+            return;
+        submit_recorded_commands();
+        // The program in use is whichever the last command needed.
+        set_shader(data->selected_frag_shader);
+    }
+
+    RetainedGeometry::RetainedGeometry():
+        data{ new Data } { }
+
+    RetainedGeometry::~RetainedGeometry()
+    {
+        if (data->buffer == 0)
+            return;
+        std::lock_guard lock{ retired_geometry_buffers_lock };
+        retired_geometry_buffers.push_back(data->buffer);
+    }
+
+    bool RetainedGeometry::empty() const
+    {
+        return data->count == 0;
+    }
+
+    bool SceneRenderer::begin_retained_geometry(RetainedGeometry* geometry)
+    {
+        assert(data->retaining == nullptr);
+        if (data->quad_submission != QuadSubmission::Instanced)
+            return false;
+        // Anything pending is drawn as usual.
+        flush();
+        RetainedGeometry::Data* retained = geometry->data.get();
+        retained->instances.clear();
+        retained->count = 0;
+        retained->segments.clear();
+        retained->upload_pending = true;
+        data->retaining = retained;
+        return true;
+    }
+
+    void SceneRenderer::end_retained_geometry()
+    {
+        assert(data->retaining != nullptr);
+        flush();
+        data->retaining = nullptr;
+    }
+
+    void SceneRenderer::draw_retained_geometry(const RetainedGeometry& geometry, const Vec2f& offset)
+    {
+        // Keep the painter's order with whatever is pending.
+        flush();
+        RetainedGeometry::Data* retained = geometry.data.get();
+        ShaderInputs inputs = shader_inputs(*data);
+        inputs.geometry_offset = offset;
+        PipelineState& pipeline = renderer_pipeline(data.get());
+        for (int i = 0; i != static_cast<int>(retained->segments.size()); ++i)
+        {
+            const RetainedSegment& segment = retained->segments[i];
+            // The slots are baked into the instances, so each texture goes back to the slot it was captured in.
+            for (int slot = 0; slot != texture_slot_count; ++slot)
+            {
+                if ((segment.slot_mask & (1u << slot)) != 0
+                    and segment.textures[slot] != 0
+                    and pipeline.textures[slot] != segment.textures[slot])
+                {
+                    renderer_bind_texture_slot(data.get(), slot, segment.textures[slot]);
+                }
+            }
+            if (data->recording)
+            {
+                record_retained_segment(data.get(), retained, i, inputs);
+            }
+            else if (gl_submission)
+            {
+                apply_batch_program(BatchTopology::InstancedQuads,
+                                    data->selected_vert_shader,
+                                    data->selected_frag_shader,
+                                    inputs);
+                draw_retained_segment(retained, i);
+            }
+            else
+            {
+                current_frame_stats.retained_quads += segment.count;
+            }
+        }
+    }
+
+    CachedLayer::CachedLayer():
+        data{ new Data } { }
+
+    CachedLayer::~CachedLayer()
+    {
+        if (data->created)
+        {
+            SceneRenderer::delete_render_texture(data->texture);
+        }
+    }
+
+    void CachedLayer::invalidate()
+    {
+        data->valid = false;
+    }
+
+    void CachedLayer::invalidate_all()
+    {
+        ++cached_layer_epoch;
+    }
+
+    bool SceneRenderer::begin_cached_layer(CachedLayer* layer, const ScreenDimensions& screen)
+    {
+        CachedLayer::Data* layer_data = layer->data.get();
+        const bool same_size = layer_data->created
+                                and layer_data->size.width == screen.width
+                                and layer_data->size.height == screen.height;
+        if (layer_data->valid and same_size and layer_data->epoch == cached_layer_epoch)
+            return false;
+        ++current_frame_stats.layers_redrawn;
+        // Anything pending belongs to the framebuffer which is bound now.
+        flush();
+        PipelineState& pipeline = renderer_pipeline(data.get());
+        layer_data->previous_blending = pipeline.blending;
+        // There is nothing to keep without GL, the layer is simply drawn (and dropped) every time.
+        if (gl_submission)
+        {
+            layer_data->previous_framebuffer = pipeline_state.framebuffer;
+            if (not layer_data->created)
+            {
+                layer_data->texture = create_render_texture(screen);
+                layer_data->created = true;
+            }
+            else if (not same_size)
+            {
+                update_render_texture(layer_data->texture, screen);
             }
+            bind_render_texture(layer_data->texture);
+            // A recording renderer keeps its own copy of the state, so it has to see the switch as well.
+            pipeline.framebuffer = pipeline_state.framebuffer;
+            reset_current_buffer(hex_to_vec4f(0x00000000));
+        }
+        layer_data->size = screen;
+        apply_blending_mode(BlendingMode::SrcAlpha);
+        return true;
+    }
+
+    void SceneRenderer::end_cached_layer(CachedLayer* layer)
+    {
+        CachedLayer::Data* layer_data = layer->data.get();
+        flush();
+        if (gl_submission)
+        {
+            submit_recorded_commands();
+            ++current_frame_stats.framebuffer_binds;
+            bind_gl_framebuffer(static_cast<GLuint>(layer_data->previous_framebuffer));
+            renderer_pipeline(data.get()).framebuffer = pipeline_state.framebuffer;
+            layer_data->valid = true;
+            layer_data->epoch = cached_layer_epoch;
         }
+        apply_blending_mode(layer_data->previous_blending);
+    }
+
+    void SceneRenderer::composite_cached_layer(const CachedLayer& layer)
+    {
+        const CachedLayer::Data* layer_data = layer.data.get();
+        if (not layer_data->created)
+            return;
+        ++current_frame_stats.layers_composited;
+        const BlendingMode previous_blending = renderer_pipeline(data.get()).blending;
+        // The layer holds premultiplied colors.
+        apply_blending_mode(BlendingMode::PremultipliedAlpha);
+        set_shader(VertShader::OneOneTransform);
+        set_shader(FragShader::Image);
+        render_render_texture(layer_data->texture);
+        apply_blending_mode(previous_blending);
+    }
 
-        // Success!  Let's move them all over.
-        for (int v = 0; v != count_of<VertShader>; ++v)
+    void SceneRenderer::end_frame()
+    {
+        delete_retired_geometry_buffers();
+        trim_framebuffer_pool();
+        // Hand the segments written this frame over to the GPU so the next frame starts on fresh ones.
+        for (StreamBuffer* stream : { &vertex_stream, &instance_stream })
         {
-            std::move(std::begin(new_programs[v]), std::end(new_programs[v]), std::begin(shader_programs[v]));
+            if (stream->mode == VertexStreamMode::PersistentRing
+                and stream->count != 0)
+            {
+                advance_stream_segment(stream);
+            }
         }
-        feed->queue_info("Shaders reloaded.");
+        last_frame_stats = current_frame_stats;
+        current_frame_stats = { };
+    }
+
+    const FrameStats& SceneRenderer::frame_stats()
+    {
+        return last_frame_stats;
+    }
+
+    const ProgramStats& SceneRenderer::program_stats()
+    {
+        return program_build_stats;
     }
 
     // Global functions for interacting with the framebuffer.
     void SceneRenderer::screen_resize(const ScreenDimensions& screen)
     {
+        submit_recorded_commands();
         screen_update(screen);
+        CachedLayer::invalidate_all();
     }
 
     void SceneRenderer::bind_framebuffer(Framebuffer idx)
     {
+        submit_recorded_commands();
         // We should only be binding to other framebuffers.  User 'unbind_framebuffer' to get back
         // to the default render buffer.
-        auto& framebuf = framebuffer_collection[rep(idx)];
-        glBindFramebuffer(GL_FRAMEBUFFER, rep(framebuf.id));
+        FramebufferData* framebuf = ensure_framebuffer(idx);
+        ++current_frame_stats.framebuffer_binds;
+        bind_gl_framebuffer(rep(framebuf->id));
+    }
+
+    Framebuffer SceneRenderer::acquire_framebuffer(TargetScale scale)
+    {
+        // Prefer a framebuffer which is already allocated at the extent for 'scale', then any free one.
+        const int downscale = downscale_factor(scale);
+        PooledFramebuffer* found = nullptr;
+        for (PooledFramebuffer& entry : framebuffer_pool)
+        {
+            if (entry.in_use)
+                continue;
+            if (rep(entry.data.id) != 0
+                and entry.downscale == downscale
+                and rep(entry.data.allocated.width) == rep(render_target_extent.width) / downscale
+                and rep(entry.data.allocated.height) == rep(render_target_extent.height) / downscale)
+            {
+                found = &entry;
+                break;
+            }
+            if (found == nullptr)
+            {
+                found = &entry;
+            }
+        }
+        if (found == nullptr)
+        {
+            found = &framebuffer_pool.emplace_back();
+        }
+        found->downscale = downscale;
+        found->in_use = true;
+        found->idle_frames = 0;
+        ++current_frame_stats.framebuffers_acquired;
+        return Framebuffer{ rep(Framebuffer::Count) + static_cast<int>(found - framebuffer_pool.data()) };
+    }
+
+    void SceneRenderer::release_framebuffer(Framebuffer fb)
+    {
+        PooledFramebuffer* entry = pooled_framebuffer(fb);
+        assert(entry != nullptr);
+        entry->in_use = false;
+        entry->idle_frames = 0;
     }
 
     void SceneRenderer::unbind_framebuffer()
     {
+        submit_recorded_commands();
         data->previous_texture = TextureUnit::Sentinel;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        ++current_frame_stats.framebuffer_binds;
+        bind_gl_framebuffer(0);
+    }
+
+    void SceneRenderer::clip_to_damage(const ScissorRegion& region)
+    {
+        submit_recorded_commands();
+        damage_clip = true;
+        FramebufferData* framebuf = ensure_framebuffer(Framebuffer::Default);
+        damage_clip_framebuffer = static_cast<GLint>(rep(framebuf->id));
+        damage_clip_box[0] = rep(region.offset_x);
+        damage_clip_box[1] = rep(region.offset_y);
+        damage_clip_box[2] = rep(region.width);
+        damage_clip_box[3] = rep(region.height);
+        send_gl_scissor(pipeline_state);
+    }
+
+    void SceneRenderer::remove_damage_clip()
+    {
+        submit_recorded_commands();
+        damage_clip = false;
+        send_gl_scissor(pipeline_state);
     }
 
     void SceneRenderer::enable_prev_pass_texture(Framebuffer prev)
     {
-        data->previous_texture = TextureUnit(framebuffer_collection[rep(prev)]
-                                    .attachments[rep(ColorAttachments::Default)]);
+        FramebufferData* framebuf = ensure_framebuffer(prev);
+        data->previous_texture = TextureUnit(framebuf->attachments[rep(ColorAttachments::Default)]);
     }
 
     void SceneRenderer::enable_prev_pass_texture(RenderTexture prev)
@@ -1138,65 +3985,72 @@ namespace Render
 
     void SceneRenderer::render_framebuffer(const ScreenDimensions& screen, Framebuffer src)
     {
-        auto& framebuf = framebuffer_collection[rep(src)];
-        bind_texture(framebuf.attachments[rep(ColorAttachments::Default)]);
+        bind_framebuffer_texture(src);
         auto width = rep(screen.width);
         auto height = rep(screen.height);
+        // Only the part of the framebuffer covered by the screen is sampled.
         render_image(Vec2f(-width + 0.f, -height + 0.f),
                                 Vec2f(width * 2.f, height * 2.f),
                                 Vec2f(0.f, 0.f),
-                                Vec2f(1.f, 1.f),
+                                framebuffer_uv_scale,
                                 hex_to_vec4f(0xFFFFFFFF));
         flush();
     }
 
     void SceneRenderer::bind_framebuffer_texture(Framebuffer src)
     {
-        auto& framebuf = framebuffer_collection[rep(src)];
-        bind_texture(framebuf.attachments[rep(ColorAttachments::Default)]);
+        FramebufferData* framebuf = ensure_framebuffer(src);
+        renderer_bind_texture(data.get(), framebuf->attachments[rep(ColorAttachments::Default)]);
     }
 
-    void SceneRenderer::render_framebuffer_layer(FramebufferIO io, FragShader shader, const ScreenDimensions& full_screen)
+    // Various buffer operations.
+    void SceneRenderer::reset_current_buffer(const Vec4f& color)
     {
-        bind_framebuffer(io.dest);
-        // Clear this framebuffer completely.
-        reset_current_buffer(hex_to_vec4f(0x00000000));
-        // We assume that 'src' has its alpha pre-blended.
-        apply_blending_mode(Render::BlendingMode::PremultipliedAlpha);
-        set_shader(shader);
-        render_framebuffer(full_screen, io.src);
+        submit_recorded_commands();
+        glClearColor(color.x, color.y, color.z, color.a);
+        glClear(GL_COLOR_BUFFER_BIT);
     }
 
-    void SceneRenderer::render_framebuffer_layer_noclear(FramebufferIO io, FragShader shader, const ScreenDimensions& full_screen)
+    void SceneRenderer::invalidate_current_buffer()
     {
-        bind_framebuffer(io.dest);
-        // We assume that 'src' has its alpha pre-blended.
-        apply_blending_mode(Render::BlendingMode::PremultipliedAlpha);
-        set_shader(shader);
-        render_framebuffer(full_screen, io.src);
+        submit_recorded_commands();
+        if (not (GLEW_VERSION_4_3 or GLEW_ARB_invalidate_subdata))
+        {
+            glClearColor(0.f, 0.f, 0.f, 0.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            return;
+        }
+        if (pipeline_state.framebuffer == 0)
+        {
+            const GLenum attachments[] = { GL_COLOR, GL_DEPTH, GL_STENCIL };
+            glInvalidateFramebuffer(GL_FRAMEBUFFER, GLsizei(std::size(attachments)), attachments);
+            return;
+        }
+        const GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT };
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, GLsizei(std::size(attachments)), attachments);
     }
 
-    // Various buffer operations.
-    void SceneRenderer::reset_current_buffer(const Vec4f& color)
+    void SceneRenderer::apply_blending_mode(BlendingMode mode)
     {
-        glClearColor(color.x, color.y, color.z, color.a);
-        glClear(GL_COLOR_BUFFER_BIT);
+        renderer_blending(data.get(), mode);
     }
 
-    void SceneRenderer::apply_blending_mode(BlendingMode mode)
+    int downscale_factor(TargetScale scale)
     {
-        switch (mode)
+        switch (scale)
         {
-        case BlendingMode::PremultipliedAlpha:
-            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-            break;
-        case BlendingMode::SrcAlpha:
-            glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-            break;
-        case BlendingMode::Default:
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            break;
+        case TargetScale::Full:
+            return 1;
+        case TargetScale::Half:
+            return 2;
+        case TargetScale::Quarter:
+            return 4;
+        case TargetScale::Eighth:
+            return 8;
+        case TargetScale::Sixteenth:
+            return 16;
         }
+        return 1;
     }
 
     void draw_background(SceneRenderer* renderer, const ScreenDimensions& screen, const Vec4f& color)
@@ -1227,20 +4081,25 @@ namespace Render
 
     void SceneRenderer::bind_render_texture(RenderTexture tex)
     {
+        submit_recorded_commands();
         RenderTextureData* tex_data = render_texture_data(tex);
-        glBindFramebuffer(GL_FRAMEBUFFER, rep(tex_data->data.id));
+        ++current_frame_stats.framebuffer_binds;
+        bind_gl_framebuffer(rep(tex_data->data.id));
     }
 
     void SceneRenderer::render_render_texture(RenderTexture tex)
     {
         RenderTextureData* tex_data = render_texture_data(tex);
-        bind_texture(tex_data->data.attachments[rep(ColorAttachments::Default)]);
+        renderer_bind_texture(data.get(), tex_data->data.attachments[rep(ColorAttachments::Default)]);
         auto width = rep(tex_data->size.width);
         auto height = rep(tex_data->size.height);
+        // The texture can be allocated larger than its size.
+        const Vec2f uv_extent(static_cast<float>(width) / rep(tex_data->data.allocated.width),
+                                static_cast<float>(height) / rep(tex_data->data.allocated.height));
         render_image(Vec2f(0.f, 0.f),
                                 Vec2f(width + 0.f, height + 0.f),
                                 Vec2f(0.f, 0.f),
-                                Vec2f(1.f, 1.f),
+                                uv_extent,
                                 hex_to_vec4f(0xFFFFFFFF));
         flush();
     }
@@ -1266,19 +4125,21 @@ namespace Render
         render_image(Vec2f(0.f, 0.f),
                                 Vec2f(width, height),
                                 Vec2f(0.f, 0.f),
-                                Vec2f(1.f, 1.f),
+                                framebuffer_uv_scale,
                                 hex_to_vec4f(0xFFFFFFFF));
         flush();
     }
 
     void SceneRenderer::update_render_texture(RenderTexture tex, const ScreenDimensions& screen)
     {
+        submit_recorded_commands();
         RenderTextureData* tex_data = render_texture_data(tex);
         ::Render::update_render_texture(tex_data, screen);
     }
 
     void SceneRenderer::delete_render_texture(RenderTexture tex)
     {
+        submit_recorded_commands();
         RenderTextureData* tex_data = render_texture_data(tex);
         ::Render::delete_render_texture(tex_data);
         dealloc_render_texture(tex);
@@ -1322,11 +4183,15 @@ namespace Render
 
     void SceneRenderer::delete_basic_texture(BasicTexture tex)
     {
+        submit_recorded_commands();
         delete_texture(rep(tex));
     }
 
     void SceneRenderer::submit_basic_texture_data(BasicTexture tex, BasicTextureEntry entry)
     {
+        submit_recorded_commands();
+        // RGBA8.
+        current_frame_stats.texture_upload_bytes += rep(entry.width) * rep(entry.height) * 4;
         bind_basic_texture(tex);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexSubImage2D(
@@ -1344,6 +4209,9 @@ namespace Render
     // Functions for creating glyph cache textures, binding, and manipulating them.
     GlyphTexture SceneRenderer::create_glyph_texture(const ScreenDimensions& dim)
     {
+        // Nothing samples the texture, any non-zero id will do.
+        if (not gl_submission)
+            return GlyphTexture{ 1 };
         // Hardcode this for now.
         glActiveTexture(GL_TEXTURE0);
         GLuint texture;
@@ -1379,11 +4247,16 @@ namespace Render
 
     void SceneRenderer::bind_glyph_texture(GlyphTexture tex)
     {
-        glBindTexture(GL_TEXTURE_2D, rep(tex));
+        bind_texture(rep(tex));
     }
 
     void SceneRenderer::submit_glyph_data(GlyphTexture tex, GlyphEntry entry)
     {
+        submit_recorded_commands();
+        // R8.
+        current_frame_stats.texture_upload_bytes += rep(entry.width) * rep(entry.height);
+        if (not gl_submission)
+            return;
         bind_glyph_texture(tex);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexSubImage2D(
@@ -1401,98 +4274,143 @@ namespace Render
 
 namespace Render::Effects
 {
-    void text_glow(FramebufferIO io, SceneRenderer* renderer, const RenderViewport& viewport, const ScreenDimensions& full_screen)
+    namespace
     {
-        auto render_viewport = renderer->create_viewport(viewport);
-        // Note: we only need to apply the full_screen viewport once until we need to change it later.
-        render_viewport.apply_viewport(RenderViewport::basic(full_screen));
-        // Framebuffer renders assume the vert shader is NoTransform.
-        renderer->set_shader(Render::VertShader::NoTransform);
-        // Blur vert.
-        // Values for the shader.
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(8.0); // TAPS.
-        renderer->render_framebuffer_layer({ .src = io.src, .dest = Framebuffer::Scratch1 }, FragShader::CRTEasymodeBlurVert, full_screen);
-
-        // Blur horiz.
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(8.0); // TAPS.
-        renderer->render_framebuffer_layer({ .src = Framebuffer::Scratch1, .dest = Framebuffer::Scratch2 }, FragShader::CRTEasymodeBlurHoriz, full_screen);
-
-        // Blend blur + original framebuffer.
-        renderer->enable_prev_pass_texture(Framebuffer::Scratch2);
-        renderer->render_framebuffer_layer({ .src = io.src, .dest = Framebuffer::Scratch1 }, FragShader::BasicTextureBlend, full_screen);
-
-        // Write out the result to the default framebuffer '0'.
-        render_viewport.reset_viewport();
-        renderer->render_framebuffer_layer_noclear({ .src = Framebuffer::Scratch1, .dest = io.dest }, FragShader::Image, full_screen);
-    }
-
-    void apply_text_glow_to(RenderTexture in, SceneRenderer* renderer, const ScreenDimensions& full_screen)
-    {
-        auto vp = RenderViewport::basic(full_screen);
-        auto render_viewport = renderer->create_viewport(vp);
-        // Note: we only need to apply the full_screen viewport once until we need to change it later.
-        render_viewport.apply_viewport(vp);
-        // Renders from render textures assume OneOneTransform.
-        renderer->set_shader(Render::VertShader::OneOneTransform);
-        SceneRenderer::bind_render_texture(in);
-        // Blur vert.
-        // Values for the shader.
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(8.0); // TAPS.
-
-        renderer->bind_framebuffer(Framebuffer::Scratch1);
-        // Clear this framebuffer completely.
-        renderer->reset_current_buffer(hex_to_vec4f(0x00000000));
+        constexpr TargetScale pyramid_scales[] = { TargetScale::Half, TargetScale::Quarter, TargetScale::Eighth, TargetScale::Sixteenth };
+
+        int pyramid_levels(BlurQuality quality)
+        {
+            switch (quality)
+            {
+            case BlurQuality::FullResolution:
+                return 0;
+            case BlurQuality::Low:
+                return 2;
+            case BlurQuality::Medium:
+                return 3;
+            case BlurQuality::High:
+                return 4;
+            }
+            return 0;
+        }
+
+        // Blurs 'src' into 'dest'.  'taps' is how far the Gaussian reaches on either side of a pixel, which the
+        // pyramid turns into how far apart its taps are.
+        void add_blur(RenderGraph* graph, GraphTarget src, GraphTarget dest, BlurQuality quality, float taps)
+        {
+            const int levels = pyramid_levels(quality);
+            if (levels == 0)
+            {
+                const GraphTarget vert = graph->create_target();
+                graph->add_pass({ .name = "Blur vertical",
+                                    .shader = FragShader::CRTEasymodeBlurVert,
+                                    .input = src,
+                                    .output = vert,
+                                    .custom_float_value1 = 0.03f, // GLOW_FALLOFF.
+                                    .custom_float_value2 = taps }); // TAPS.
+                graph->add_pass({ .name = "Blur horizontal",
+                                    .shader = FragShader::CRTEasymodeBlurHoriz,
+                                    .input = vert,
+                                    .output = dest,
+                                    .custom_float_value1 = 0.03f, // GLOW_FALLOFF.
+                                    .custom_float_value2 = taps }); // TAPS.
+                return;
+            }
+
+            // Down to the smallest level and back up, the last step of which lands in 'dest'.
+            const float offset = taps / 4.f;
+            GraphTarget from = src;
+            for (int i = 0; i != levels; ++i)
+            {
+                const GraphTarget to = graph->create_target(pyramid_scales[i]);
+                graph->add_pass({ .name = "Blur downsample",
+                                    .shader = FragShader::DualKawaseDown,
+                                    .input = from,
+                                    .output = to,
+                                    .custom_float_value1 = offset });
+                from = to;
+            }
+            for (int i = levels - 1; i != 0; --i)
+            {
+                const GraphTarget to = graph->create_target(pyramid_scales[i - 1]);
+                graph->add_pass({ .name = "Blur upsample",
+                                    .shader = FragShader::DualKawaseUp,
+                                    .input = from,
+                                    .output = to,
+                                    .custom_float_value1 = offset });
+                from = to;
+            }
+            graph->add_pass({ .name = "Blur upsample",
+                                .shader = FragShader::DualKawaseUp,
+                                .input = from,
+                                .output = dest,
+                                .custom_float_value1 = offset });
+        }
+
+        // Writes 'src' with a glow around it to 'dest'.
+        void add_glow(RenderGraph* graph, GraphTarget src, GraphTarget dest, BlurQuality quality)
+        {
+            const GraphTarget glow = graph->create_target();
+            add_blur(graph, src, glow, quality, 8.f);
+            // Blend blur + original framebuffer.
+            graph->add_pass({ .name = "Glow blend",
+                                .shader = FragShader::BasicTextureBlend,
+                                .input = src,
+                                .output = dest,
+                                .previous = glow });
+        }
+    } // namespace [anon]
+
+    void text_glow(FramebufferIO io, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality)
+    {
+        GPUProfiler::Scope gpu_scope{ "Text glow" };
+        RenderGraph graph;
+        const GraphTarget src = graph.import_framebuffer(io.src);
+        const GraphTarget dest = graph.import_framebuffer(io.dest);
+        const GraphTarget blended = graph.create_target();
+        add_glow(&graph, src, blended, quality);
         // We assume that 'src' has its alpha pre-blended.
-        renderer->apply_blending_mode(Render::BlendingMode::PremultipliedAlpha);
-        renderer->set_shader(FragShader::CRTEasymodeBlurVert);
-        renderer->render_render_texture(in);
+        graph.add_pass({ .name = "Glow composite",
+                            .shader = FragShader::Image,
+                            .input = blended,
+                            .output = dest,
+                            .blending = BlendingMode::PremultipliedAlpha });
+        graph.execute(renderer, full_screen);
+    }
 
-        // Blur horiz.
-        // Note: framebuffer -> framebuffer assumes NoTransform shader.
-        renderer->set_shader(Render::VertShader::NoTransform);
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(8.0); // TAPS.
-        renderer->render_framebuffer_layer({ .src = Framebuffer::Scratch1, .dest = Framebuffer::Scratch2 }, FragShader::CRTEasymodeBlurHoriz, full_screen);
-
-        // In order to prevent a scenario where we need 3 framebuffers, we will output the original image
-        // to a scratch framebuffer so we can use this framebuffer as input when rendering the final image
-        // back to the render texture.
-        renderer->apply_blending_mode(Render::BlendingMode::PremultipliedAlpha);
-        renderer->bind_framebuffer(Framebuffer::Scratch1);
-        renderer->reset_current_buffer(hex_to_vec4f(0x00000000));
-        renderer->set_shader(Render::VertShader::OneOneTransform);
-        renderer->set_shader(Render::FragShader::Image);
-        renderer->render_render_texture(in);
-
-        // Blend blur + original framebuffer.
-        // Render back to texture.
-        renderer->enable_prev_pass_texture(Framebuffer::Scratch2);
-        renderer->render_framebuffer_to_render_texture(Framebuffer::Scratch1, in, FragShader::BasicTextureBlend, full_screen);
-    }
-
-    void blur_background(FramebufferIO io, SceneRenderer* renderer, const RenderViewport& viewport, const ScreenDimensions& full_screen)
-    {
-        auto render_viewport = renderer->create_viewport(viewport);
-        // Note: we only need to apply the full_screen viewport once until we need to change it later.
-        render_viewport.apply_viewport(RenderViewport::basic(full_screen));
-
-        // Blur vert.
-        // Values for the shader.
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(4.0); // TAPS.
-        renderer->render_framebuffer_layer({ .src = io.src, .dest = Framebuffer::Scratch1 }, FragShader::CRTEasymodeBlurVert, full_screen);
-
-        // Blur horiz.
-        renderer->custom_float_value1(0.03f); // GLOW_FALLOFF.
-        renderer->custom_float_value2(4.0); // TAPS.
-        renderer->render_framebuffer_layer({ .src = Framebuffer::Scratch1, .dest = Framebuffer::Scratch2 }, FragShader::CRTEasymodeBlurHoriz, full_screen);
-
-        // Reapply to default framebuffer.
-        // Since we're not blending, we want to stomp on the dest framebuffer with a clear.
-        render_viewport.reset_viewport();
-        renderer->render_framebuffer_layer({ .src = Framebuffer::Scratch2, .dest = io.dest }, FragShader::Image, full_screen);
+    void apply_text_glow_to(RenderTexture in, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality)
+    {
+        GPUProfiler::Scope gpu_scope{ "Text glow (render texture)" };
+        // The graph only deals in framebuffers, so the texture is copied into one and the result copied back.
+        const Framebuffer original = SceneRenderer::acquire_framebuffer();
+        const Framebuffer glowing = SceneRenderer::acquire_framebuffer();
+        {
+            auto render_viewport = renderer->create_viewport(full_screen);
+            render_viewport.apply_viewport(RenderViewport::basic(full_screen));
+            renderer->bind_framebuffer(original);
+            renderer->invalidate_current_buffer();
+            renderer->apply_blending_mode(BlendingMode::Replace);
+            // Renders from render textures assume OneOneTransform.
+            renderer->set_shader(VertShader::OneOneTransform);
+            renderer->set_shader(FragShader::Image);
+            renderer->render_render_texture(in);
+        }
+
+        RenderGraph graph;
+        add_glow(&graph, graph.import_framebuffer(original), graph.import_framebuffer(glowing), quality);
+        graph.execute(renderer, full_screen);
+
+        renderer->render_framebuffer_to_render_texture(glowing, in, FragShader::Image, full_screen);
+        SceneRenderer::release_framebuffer(original);
+        SceneRenderer::release_framebuffer(glowing);
+    }
+
+    void blur_background(FramebufferIO io, SceneRenderer* renderer, const ScreenDimensions& full_screen, BlurQuality quality)
+    {
+        GPUProfiler::Scope gpu_scope{ "Background blur" };
+        // Since the blur overwrites all of 'dest', there is no need to clear it first.
+        RenderGraph graph;
+        add_blur(&graph, graph.import_framebuffer(io.src), graph.import_framebuffer(io.dest), quality, 4.f);
+        graph.execute(renderer, full_screen);
     }
 } // namespace Render::Effects
\ No newline at end of file
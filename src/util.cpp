@@ -121,6 +121,16 @@ bool dir_exists(std::string_view dir_path)
     return std::filesystem::is_directory(p, ec);
 }
 
+uint64_t file_write_time(std::string_view file_path)
+{
+    std::error_code ec;
+    std::filesystem::path p = reinterpret_cast<const char8_t*>(file_path.data());
+    auto time = std::filesystem::last_write_time(p, ec);
+    if (ec)
+        return 0;
+    return static_cast<uint64_t>(time.time_since_epoch().count());
+}
+
 std::string working_dir()
 {
     std::error_code ec;
@@ -182,6 +192,19 @@ std::string default_config_directory()
     return { reinterpret_cast<const char*>(str.c_str()), str.size() };
 }
 
+std::string default_program_cache_directory()
+{
+    char* user_path = SDL_GetPrefPath("cadacama", "basic-ui-template");
+    std::filesystem::path p = user_path;
+    SDL_free(user_path);
+    p /= "program-cache";
+    std::error_code ec;
+    std::filesystem::create_directories(p, ec);
+    // Convert to UTF8.
+    auto str = p.u8string();
+    return { reinterpret_cast<const char*>(str.c_str()), str.size() };
+}
+
 void set_platform_window(OpaqueWindow window)
 {
     SDL_SysWMinfo info{};
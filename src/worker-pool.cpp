@@ -0,0 +1,111 @@
+#include "worker-pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpu-profiler.h"
+
+namespace Workers
+{
+    struct WorkerPool::Data
+    {
+        std::vector<std::thread> threads;
+
+        std::mutex lock;
+        // Signaled when a job is queued or the pool shuts down.
+        std::condition_variable job_ready;
+        // Signaled when the last outstanding job finishes.
+        std::condition_variable jobs_done;
+        std::deque<Job> jobs;
+        // Queued plus running.
+        int outstanding = 0;
+        bool shutdown = false;
+    };
+
+    namespace
+    {
+        void worker_loop(WorkerPool::Data* data)
+        {
+            CPU_PROFILE_THREAD("Worker");
+            while (true)
+            {
+                Job job;
+                {
+                    std::unique_lock lock{ data->lock };
+                    data->job_ready.wait(lock, [&] { return data->shutdown or not data->jobs.empty(); });
+                    if (data->jobs.empty())
+                        return;
+                    job = std::move(data->jobs.front());
+                    data->jobs.pop_front();
+                }
+                job();
+                {
+                    std::lock_guard lock{ data->lock };
+                    --data->outstanding;
+                    if (data->outstanding == 0)
+                    {
+                        data->jobs_done.notify_all();
+                    }
+                }
+            }
+        }
+    } // namespace [anon]
+
+    WorkerPool::WorkerPool():
+        data{ new Data } { }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard lock{ data->lock };
+            data->shutdown = true;
+        }
+        data->job_ready.notify_all();
+        for (auto& thread : data->threads)
+        {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::init(int count)
+    {
+        data->threads.reserve(count);
+        for (int i = 0; i != count; ++i)
+        {
+            data->threads.emplace_back(worker_loop, data.get());
+        }
+    }
+
+    void WorkerPool::submit(Job job)
+    {
+        // Without threads the caller does the work.
+        if (data->threads.empty())
+        {
+            job();
+            return;
+        }
+        {
+            std::lock_guard lock{ data->lock };
+            data->jobs.push_back(std::move(job));
+            ++data->outstanding;
+        }
+        data->job_ready.notify_one();
+    }
+
+    void WorkerPool::wait()
+    {
+        CPU_PROFILE_SCOPE("WorkerPool::wait");
+        std::unique_lock lock{ data->lock };
+        data->jobs_done.wait(lock, [&] { return data->outstanding == 0; });
+    }
+
+    int default_worker_count()
+    {
+        const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        return std::max(hardware - 1, 1);
+    }
+} // namespace Workers
\ No newline at end of file